@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "utils/Compression.hpp"
+
+/// Checks the lz codec used by recordings and measures it.
+/// Every input has to round-trip exactly, and damaged blocks (truncated, bytes
+/// flipped, wrong expected size) have to be rejected or decode without touching
+/// memory outside the buffers, which is what ASan/UBSan builds check.
+/// The exit code is a failure if any check fails.
+///
+/// usage: bench_codec [fuzz iterations]
+
+using Clock = std::chrono::steady_clock;
+
+struct Input {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+static std::vector<Input> makeInputs(std::mt19937& random) {
+    std::vector<Input> inputs;
+    inputs.push_back({ "empty", {} });
+    inputs.push_back({ "one byte", { 42 } });
+    inputs.push_back({ "short", { 1, 2, 3, 4, 1, 2, 3, 4, 1 } });
+    inputs.push_back({ "zeros", std::vector<uint8_t>(1 << 20, 0) });
+
+    std::vector<uint8_t> noise(1 << 20);
+    for (uint8_t& byte : noise) {
+        byte = (uint8_t)random();
+    }
+    inputs.push_back({ "noise", noise });
+
+    // what the recorder produces: small deltas around zero split into a low and a high plane
+    const size_t count = 1 << 18;
+    std::vector<uint8_t> planes(count * 2);
+    std::normal_distribution<float> delta(0.0f, 3.0f);
+    for (size_t i = 0; i < count; i++) {
+        const uint16_t value = (uint16_t)(int16_t)delta(random);
+        planes[i] = (uint8_t)value;
+        planes[count + i] = (uint8_t)(value >> 8);
+    }
+    inputs.push_back({ "delta planes", planes });
+
+    // long matches, repeats far back and runs longer than one length byte
+    std::vector<uint8_t> text;
+    const char* words[] = { "verlet ", "particle ", "grid ", "collision ", "step " };
+    while (text.size() < (1 << 20)) {
+        const char* word = words[random() % 5];
+        text.insert(text.end(), word, word + strlen(word));
+        if (random() % 64 == 0) {
+            text.insert(text.end(), 1000 + random() % 5000, (uint8_t)random());
+        }
+    }
+    inputs.push_back({ "repeats", text });
+    return inputs;
+}
+
+// compresses and decompresses `input`, false if anything doesn't match
+static bool roundTrip(const Input& input, double& compressMs, double& decompressMs, size_t& compressedSize) {
+    std::vector<uint8_t> compressed(lz::CompressBound(input.bytes.size()));
+    Clock::time_point start = Clock::now();
+    compressedSize = lz::Compress(input.bytes.data(), input.bytes.size(), compressed.data());
+    compressMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (compressedSize > compressed.size()) {
+        return false;
+    }
+    std::vector<uint8_t> decompressed(input.bytes.size());
+    start = Clock::now();
+    const bool decoded = lz::Decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size());
+    decompressMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!decoded || decompressed != input.bytes) {
+        return false;
+    }
+    // a block is only valid for its exact size
+    std::vector<uint8_t> larger(input.bytes.size() + 1);
+    if (lz::Decompress(compressed.data(), compressedSize, larger.data(), larger.size())) {
+        return false;
+    }
+    return input.bytes.empty()
+        || !lz::Decompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size() - 1);
+}
+
+// damages valid blocks, decoding them must not crash (or trip the sanitizers)
+// and truncated blocks must always be rejected
+static bool fuzz(const std::vector<Input>& inputs, uint32_t iterations, std::mt19937& random) {
+    for (const Input& input : inputs) {
+        std::vector<uint8_t> compressed(lz::CompressBound(input.bytes.size()));
+        compressed.resize(lz::Compress(input.bytes.data(), input.bytes.size(), compressed.data()));
+        std::vector<uint8_t> output(input.bytes.size());
+        for (uint32_t i = 0; i < iterations; i++) {
+            // exact sized copies, so ASan catches any read past the end
+            const size_t truncated = random() % compressed.size();
+            std::vector<uint8_t> prefix(compressed.begin(), compressed.begin() + truncated);
+            if (lz::Decompress(prefix.data(), prefix.size(), output.data(), output.size()) && !output.empty()) {
+                printf("[✗] %s: a block truncated to %zu bytes was accepted\n", input.name.c_str(), truncated);
+                return false;
+            }
+            std::vector<uint8_t> damaged = compressed;
+            const uint32_t flips = 1 + random() % 4;
+            for (uint32_t flip = 0; flip < flips; flip++) {
+                damaged[random() % damaged.size()] ^= (uint8_t)(1 + random() % 255);
+            }
+            lz::Decompress(damaged.data(), damaged.size(), output.data(), output.size());
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t iterations = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 200;
+    std::mt19937 random(42);
+    const std::vector<Input> inputs = makeInputs(random);
+
+    bool passed = true;
+    printf("%-14s %10s %10s %8s %12s %12s\n", "input", "bytes", "packed", "ratio", "comp MB/s", "decomp MB/s");
+    for (const Input& input : inputs) {
+        double compressMs = 0.0, decompressMs = 0.0;
+        size_t compressedSize = 0;
+        if (!roundTrip(input, compressMs, decompressMs, compressedSize)) {
+            printf("[✗] %s: round trip failed\n", input.name.c_str());
+            passed = false;
+            continue;
+        }
+        const double megabytes = input.bytes.size() / (1024.0 * 1024.0);
+        printf(
+            "%-14s %10zu %10zu %8.3f %12.0f %12.0f\n",
+            input.name.c_str(), input.bytes.size(), compressedSize,
+            input.bytes.empty() ? 0.0 : (double)compressedSize / input.bytes.size(),
+            compressMs > 0.0 ? megabytes / (compressMs / 1000.0) : 0.0,
+            decompressMs > 0.0 ? megabytes / (decompressMs / 1000.0) : 0.0
+        );
+    }
+    if (!fuzz(inputs, iterations, random)) {
+        passed = false;
+    }
+    printf(passed ? "[✓] codec checks passed\n" : "[✗] codec checks failed\n");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Constants.hpp"
+#include "Engine/Scenes.hpp"
+#include "Engine/Simulation.hpp"
+#include "Engine/VerletEngine.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/ThreadPool.hpp"
+
+/// Runs a fixed set of named scenes for a fixed number of frames over a sweep of
+/// particle counts and thread counts, then writes one row per run as CSV and JSON.
+/// Every run starts from srand(seed) with the same flags as main.cpp, so two builds
+/// can be compared run by run. Per phase timings and pair counts come from the
+/// profiler, build with PROFILER=0 and only the frame times are left.
+///
+/// usage: bench_scenarios [frames] [counts] [threads] [scenarios] [results.csv] [results.json]
+///   counts, threads and scenarios are comma separated lists, scenarios defaults to all of them
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t width = Constants::SCREEN_WIDTH;
+static constexpr uint32_t height = Constants::SCREEN_HEIGHT;
+static constexpr float radius = Constants::PARTICLE_RADIUS;
+
+// phases a headless run can spend time in, the render ones stay at zero
+static constexpr prof::Phase reportedPhases[] = {
+    prof::Phase::Simulation,
+    prof::Phase::Step,
+    prof::Phase::Reorder,
+    prof::Phase::GridBuild,
+    prof::Phase::PairGeneration,
+    prof::Phase::PairResolution,
+};
+static constexpr size_t reportedPhasesCount = sizeof(reportedPhases) / sizeof(reportedPhases[0]);
+
+struct Scenario {
+    const char* name;
+    // spawns the scene with about `count` dynamic particles
+    void (*setup)(VerletEngine& engine, Simulation& simulation, uint32_t count);
+    // called before every timed frame, nullptr when the scene doesn't change
+    void (*frame)(VerletEngine& engine, uint32_t count, uint32_t frame, uint32_t frames);
+};
+
+struct RunResult {
+    const char* scenario;
+    size_t particles = 0;
+    size_t staticColliders = 0;
+    size_t threads = 0;
+    uint32_t frames = 0;
+    uint64_t steps = 0;
+    double totalMs = 0.0;
+    double minMs = DBL_MAX;
+    double maxMs = 0.0;
+    double phaseMs[reportedPhasesCount] = {};
+    uint64_t pairTests = 0;
+    double particleSteps = 0.0;
+};
+
+// the full grid main.cpp would spawn, dropped from the top of the screen
+static void setupFallingGrid(VerletEngine& engine, Simulation&, uint32_t count) {
+    Scenes::SpawnParticles(engine, width, height, 1.0f, count);
+}
+
+// rows packed against the floor, stepped untimed until the pile has settled
+static void setupSettledPile(VerletEngine& engine, Simulation& simulation, uint32_t count) {
+    const float diameter = radius * 2.0f;
+    const uint32_t columns = (uint32_t)(width / diameter);
+    engine.EnsureCapacity(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t row = i / columns, column = i % columns;
+        // every other row is shifted by half a radius, closer to how a pile packs
+        const float x = column * diameter + radius + (row % 2 == 1 ? radius * 0.5f : 0.0f);
+        const float y = height - radius - row * diameter * 0.9f;
+        engine.AddParticle(Vector2 { x, y }, radius, RED);
+    }
+    const float dt = 1.0f / Constants::PREFERRED_FPS;
+    for (uint32_t frame = 0; frame < Constants::PREFERRED_FPS * 2; frame++) {
+        simulation.Advance(dt);
+    }
+}
+
+// mostly small particles with a few larger ones, the case the multi level grid is for
+static void setupMixedRadii(VerletEngine& engine, Simulation&, uint32_t count) {
+    const float radii[] = { radius, radius * 2.0f, radius * 4.0f };
+    // 85% small, 12% medium, 3% large
+    const float rowHeight = radii[2] * 2.0f;
+    engine.EnsureCapacity(count);
+    float x = 0.0f, y = radii[2];
+    for (uint32_t i = 0; i < count; i++) {
+        const int roll = rand() % 100;
+        const float r = roll < 85 ? radii[0] : (roll < 97 ? radii[1] : radii[2]);
+        if (x + r * 2.0f > width) {
+            x = 0.0f;
+            y += rowHeight;
+        }
+        // past the bottom the rest overlaps the earlier rows and pushes its way out
+        engine.AddParticle(Vector2 { x + r, std::fmod(y, (float)height) }, r, RED);
+        x += r * 2.0f;
+    }
+}
+
+// starts empty, particles are added at one point every frame like holding the mouse
+static void setupStream(VerletEngine& engine, Simulation&, uint32_t count) {
+    engine.EnsureCapacity(count);
+}
+
+static void emitStream(VerletEngine& engine, uint32_t count, uint32_t frame, uint32_t frames) {
+    // everything is out after three quarters of the run, the rest lands and piles up
+    const uint32_t emitFrames = std::max(1u, frames * 3 / 4);
+    if (frame >= emitFrames || engine.ParticlesCount() >= count) {
+        return;
+    }
+    const uint32_t perFrame = (count + emitFrames - 1) / emitFrames;
+    const uint32_t emitted = std::min<uint32_t>(perFrame, count - (uint32_t)engine.ParticlesCount());
+    // a short burst around the emitter, wrapped in rows so large counts fit
+    const float diameter = radius * 2.0f;
+    const uint32_t columns = 32;
+    const Vector2 emitter = Vector2 { width / 2.0f - columns * radius, height / 8.0f };
+    for (uint32_t i = 0; i < emitted; i++) {
+        const float jitter = (float)rand() / RAND_MAX * radius * 0.5f;
+        engine.AddParticle(Vector2 {
+            emitter.x + (i % columns) * diameter + jitter,
+            emitter.y - (i / columns) * diameter
+        }, radius, RED);
+    }
+    engine.WakeAround(Vector2 { width / 2.0f, emitter.y }, columns * diameter);
+}
+
+// a peg board of static colliders (up to a quarter of the count) under a falling fill
+static void setupManyFixed(VerletEngine& engine, Simulation&, uint32_t count) {
+    const uint32_t pegs = std::max(1u, count / 4);
+    const float top = height * 0.35f, bottom = height * 0.85f;
+    const float spacing = std::max(radius * 4.0f, std::sqrt(width * (bottom - top) / pegs));
+    uint32_t row = 0;
+    for (float y = top; y < bottom; y += spacing, row++) {
+        const float offset = row % 2 == 1 ? spacing / 2.0f : 0.0f;
+        for (float x = offset + radius; x < width; x += spacing) {
+            engine.AddFixedParticle(Vector2 { x, y }, radius, GRAY);
+        }
+    }
+    Scenes::SpawnParticles(engine, width, (uint32_t)(top - radius * 4.0f), 1.0f, count);
+}
+
+// a falling fill poured through the signed distance field funnel and onto its bumper
+static void setupFunnel(VerletEngine& engine, Simulation&, uint32_t count) {
+    Scenes::AddFunnelObstacles(engine, width, height);
+    Scenes::SpawnParticles(engine, width, (uint32_t)(height * 0.4f), 1.0f, count);
+}
+
+static const Scenario scenarios[] = {
+    { "falling_grid", setupFallingGrid, nullptr },
+    { "settled_pile", setupSettledPile, nullptr },
+    { "mixed_radii", setupMixedRadii, nullptr },
+    { "stream", setupStream, emitStream },
+    { "many_fixed", setupManyFixed, nullptr },
+    { "funnel", setupFunnel, nullptr },
+};
+
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        // blanks around and between the commas don't count as items
+        const size_t first = list.find_first_not_of(" \t", start);
+        const size_t last = list.find_last_not_of(" \t", end == 0 ? 0 : end - 1);
+        if (first != std::string::npos && first < end && last >= first) {
+            items.push_back(list.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+    return items;
+}
+
+static RunResult runScenario(const Scenario& scenario, uint32_t count, size_t threads, uint32_t frames, uint32_t seed) {
+    mt::ThreadPool threadPool(threads);
+    VerletEngine engine(threadPool);
+    Simulation simulation(engine, width, height);
+    prof::Profiler& profiler = prof::Profiler::Instance();
+    profiler.AttachThreadPool(&threadPool);
+
+    srand(seed);
+    scenario.setup(engine, simulation, count);
+    // an empty frame drops whatever the setup recorded, the first timed frame starts clean
+    profiler.BeginFrame();
+    profiler.EndFrame();
+
+    RunResult result;
+    result.scenario = scenario.name;
+    result.threads = threads;
+    result.frames = frames;
+    const float dt = 1.0f / Constants::PREFERRED_FPS;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (scenario.frame != nullptr) {
+            scenario.frame(engine, count, frame, frames);
+        }
+        Clock::time_point start = Clock::now();
+        profiler.BeginFrame();
+        simulation.Advance(dt);
+        profiler.EndFrame();
+        const double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        result.totalMs += frameMs;
+        result.minMs = std::min(result.minMs, frameMs);
+        result.maxMs = std::max(result.maxMs, frameMs);
+        result.steps += simulation.GetLastFrameSteps();
+        // the stream grows, so particle steps are summed frame by frame
+        result.particleSteps += (double)engine.ParticlesCount() * simulation.GetLastFrameSteps();
+        for (size_t p = 0; p < reportedPhasesCount; p++) {
+            result.phaseMs[p] += profiler.GetLastFrameMs(reportedPhases[p]);
+        }
+        result.pairTests += profiler.GetLastFrameCount(prof::Counter::PairTests);
+    }
+    result.particles = engine.ParticlesCount();
+    result.staticColliders = engine.StaticCollidersCount();
+    // the pool goes away with this run
+    profiler.AttachThreadPool(nullptr);
+    return result;
+}
+
+// phase names with spaces don't make good CSV headers or JSON keys
+static std::string phaseKey(prof::Phase phase) {
+    std::string key = prof::PhaseName(phase);
+    std::replace(key.begin(), key.end(), ' ', '_');
+    return key + "_ms";
+}
+
+static bool writeCsv(const char* path, const std::vector<RunResult>& results) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "scenario,particles,static,threads,frames,steps,frame_avg_ms,frame_min_ms,frame_max_ms");
+    for (prof::Phase phase : reportedPhases) {
+        fprintf(file, ",%s", phaseKey(phase).c_str());
+    }
+    fprintf(file, ",pair_tests_per_s,particle_steps_per_s\n");
+    for (const RunResult& result : results) {
+        const double seconds = result.totalMs / 1000.0;
+        fprintf(file, "%s,%zu,%zu,%zu,%u,%llu,%.4f,%.4f,%.4f",
+            result.scenario, result.particles, result.staticColliders, result.threads, result.frames,
+            (unsigned long long)result.steps, result.totalMs / result.frames, result.minMs, result.maxMs);
+        for (size_t p = 0; p < reportedPhasesCount; p++) {
+            fprintf(file, ",%.4f", result.phaseMs[p] / result.frames);
+        }
+        fprintf(file, ",%.0f,%.0f\n", result.pairTests / seconds, result.particleSteps / seconds);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool writeJson(const char* path, const std::vector<RunResult>& results) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const RunResult& result = results[i];
+        const double seconds = result.totalMs / 1000.0;
+        fprintf(file, "  {\"scenario\": \"%s\", \"particles\": %zu, \"static\": %zu, \"threads\": %zu, "
+            "\"frames\": %u, \"steps\": %llu, \"frame_avg_ms\": %.4f, \"frame_min_ms\": %.4f, \"frame_max_ms\": %.4f",
+            result.scenario, result.particles, result.staticColliders, result.threads, result.frames,
+            (unsigned long long)result.steps, result.totalMs / result.frames, result.minMs, result.maxMs);
+        for (size_t p = 0; p < reportedPhasesCount; p++) {
+            fprintf(file, ", \"%s\": %.4f", phaseKey(reportedPhases[p]).c_str(), result.phaseMs[p] / result.frames);
+        }
+        fprintf(file, ", \"pair_tests_per_s\": %.0f, \"particle_steps_per_s\": %.0f}%s\n",
+            result.pairTests / seconds, result.particleSteps / seconds, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "]\n");
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t frames = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 300;
+    const std::string countsList = argc > 2 ? argv[2] : "10000,20000," + std::to_string(Constants::SPAWN_LIMIT);
+    const std::string threadsList = argc > 3
+        ? argv[3] : "1,2,4," + std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    const std::string scenariosList = argc > 4 ? argv[4] : "all";
+    const char* csvPath = argc > 5 ? argv[5] : "bench_scenarios.csv";
+    const char* jsonPath = argc > 6 ? argv[6] : "bench_scenarios.json";
+    const uint32_t seed = 42;
+
+    if (frames == 0) {
+        fprintf(stderr, "frames must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    FeatureFlags& flags = FeatureFlags::Instance();
+    flags.Enable(Feature::Motion);
+    flags.Enable(Feature::Gravity);
+    flags.Enable(Feature::SpatialHash);
+    flags.Enable(Feature::DenseGrid);
+    flags.Enable(Feature::LockFreeSolve);
+    flags.Enable(Feature::StreamingCollisions);
+    flags.Enable(Feature::IncrementalGrid);
+    flags.Enable(Feature::MultiLevelGrid);
+    flags.Enable(Feature::Sleeping);
+
+    std::vector<uint32_t> counts;
+    for (const std::string& item : splitList(countsList)) {
+        counts.push_back((uint32_t)std::stoul(item));
+    }
+    std::vector<size_t> threadCounts;
+    for (const std::string& item : splitList(threadsList)) {
+        const size_t threads = std::max<size_t>(1, std::stoul(item));
+        // the default list repeats the core count on small machines
+        if (std::find(threadCounts.begin(), threadCounts.end(), threads) == threadCounts.end()) {
+            threadCounts.push_back(threads);
+        }
+    }
+    std::vector<const Scenario*> selected;
+    for (const Scenario& scenario : scenarios) {
+        if (scenariosList == "all") {
+            selected.push_back(&scenario);
+        }
+    }
+    for (const std::string& name : splitList(scenariosList == "all" ? "" : scenariosList)) {
+        auto found = std::find_if(std::begin(scenarios), std::end(scenarios), [&](const Scenario& scenario) {
+            return name == scenario.name;
+        });
+        if (found == std::end(scenarios)) {
+            fprintf(stderr, "unknown scenario: %s\n", name.c_str());
+            return EXIT_FAILURE;
+        }
+        selected.push_back(found);
+    }
+    if (counts.empty() || threadCounts.empty() || selected.empty()) {
+        // nothing would run and the result files would be written empty
+        fprintf(stderr, "usage: bench_scenarios [frames] [counts] [threads] [scenarios] [results.csv] [results.json]\n");
+        fprintf(stderr, "counts, threads and scenarios need at least one item, scenarios:");
+        for (const Scenario& scenario : scenarios) {
+            fprintf(stderr, " %s", scenario.name);
+        }
+        fprintf(stderr, " (or all)\n");
+        return EXIT_FAILURE;
+    }
+    if (!prof::Profiler::enabled) {
+        printf("built without ENABLE_PROFILER, phase timings and pair tests are reported as 0\n");
+    }
+
+    std::vector<RunResult> results;
+    printf("%-14s %9s %7s %10s %12s %14s %16s\n",
+        "scenario", "particles", "threads", "frame ms", "max ms", "pair tests/s", "particle steps/s");
+    for (const Scenario* scenario : selected) {
+        for (uint32_t count : counts) {
+            for (size_t threads : threadCounts) {
+                RunResult result = runScenario(*scenario, count, threads, frames, seed);
+                const double seconds = result.totalMs / 1000.0;
+                printf("%-14s %9zu %7zu %10.3f %12.3f %14.0f %16.0f\n",
+                    result.scenario, result.particles, threads, result.totalMs / frames, result.maxMs,
+                    result.pairTests / seconds, result.particleSteps / seconds);
+                fflush(stdout);
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (!writeCsv(csvPath, results)) {
+        fprintf(stderr, "could not write results to %s\n", csvPath);
+        return EXIT_FAILURE;
+    }
+    if (!writeJson(jsonPath, results)) {
+        fprintf(stderr, "could not write results to %s\n", jsonPath);
+        return EXIT_FAILURE;
+    }
+    printf("results written to %s and %s\n", csvPath, jsonPath);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "Constants.hpp"
+#include "Engine/Scenes.hpp"
+#include "Engine/VerletEngine.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/ThreadPool.hpp"
+
+/// Compares the shared queue and work stealing schedulers of mt::ThreadPool
+/// on the engine's own Update and ResolveCollisions workloads.
+/// Also counts heap allocations of warmed up dispatches, which have to be zero,
+/// the exit code is a failure otherwise.
+///
+/// usage: bench_threadpool [threads] [frames]
+
+using Clock = std::chrono::steady_clock;
+
+// every operator new of the process goes through here
+static std::atomic<uint64_t> allocationsCount = { 0 };
+
+void* operator new(size_t size) {
+    allocationsCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+struct BenchResult {
+    double updateMs = 0.0;
+    double collisionsMs = 0.0;
+};
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static BenchResult runBench(mt::Scheduling scheduling, size_t threads, uint32_t frames) {
+    mt::ThreadPool threadPool(threads, scheduling);
+    VerletEngine engine(threadPool);
+    srand(42);
+    Scenes::SpawnDefault(engine, Constants::SCREEN_WIDTH, Constants::SCREEN_HEIGHT);
+
+    const float dt = 1.0f / Constants::PREFERRED_FPS;
+    const uint32_t substeps = 4;
+    BenchResult result;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        Clock::time_point start = Clock::now();
+        engine.ApplyGravity(Constants::GRAVITY);
+        engine.Update(dt);
+        engine.ApplyConstraints(Constants::SCREEN_WIDTH, Constants::SCREEN_HEIGHT);
+        result.updateMs += elapsedMs(start);
+
+        start = Clock::now();
+        for (uint32_t i = 0; i < substeps; i++) {
+            engine.ResolveCollisions();
+        }
+        result.collisionsMs += elapsedMs(start);
+    }
+    result.updateMs /= frames;
+    result.collisionsMs /= frames;
+    return result;
+}
+
+// heap allocations per dispatch once the task ring and range queues have grown
+static double countDispatchAllocations(mt::Scheduling scheduling, size_t threads) {
+    mt::ThreadPool threadPool(threads, scheduling);
+    std::vector<uint32_t> values(1 << 16, 0);
+    // the same kind of callback the engine passes, capturing a few locals by reference
+    auto pass = [&]() {
+        const uint32_t increment = 1;
+        threadPool.dispatch(values.size(), [&](size_t start, size_t end) {
+            for (size_t i = start; i < end; i++) {
+                values[i] += increment;
+            }
+        });
+    };
+    const uint32_t warmup = 100, dispatches = 1000;
+    for (uint32_t i = 0; i < warmup; i++) {
+        pass();
+    }
+    const uint64_t before = allocationsCount.load();
+    for (uint32_t i = 0; i < dispatches; i++) {
+        pass();
+    }
+    return (double)(allocationsCount.load() - before) / dispatches;
+}
+
+int main(int argc, char** argv) {
+    const size_t threads = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t frames = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 300;
+
+    FeatureFlags& flags = FeatureFlags::Instance();
+    flags.Enable(Feature::Motion);
+    flags.Enable(Feature::Gravity);
+    flags.Enable(Feature::SpatialHash);
+    flags.Enable(Feature::DenseGrid);
+    flags.Enable(Feature::LockFreeSolve);
+
+    printf("threads: %zu, frames: %u\n", threads, frames);
+    printf("%-14s %12s %16s\n", "scheduler", "update ms", "collisions ms");
+    const BenchResult shared = runBench(mt::Scheduling::SharedQueue, threads, frames);
+    printf("%-14s %12.3f %16.3f\n", "shared-queue", shared.updateMs, shared.collisionsMs);
+    const BenchResult stealing = runBench(mt::Scheduling::WorkStealing, threads, frames);
+    printf("%-14s %12.3f %16.3f\n", "work-stealing", stealing.updateMs, stealing.collisionsMs);
+
+    const double sharedAllocations = countDispatchAllocations(mt::Scheduling::SharedQueue, threads);
+    const double stealingAllocations = countDispatchAllocations(mt::Scheduling::WorkStealing, threads);
+    printf("allocations per dispatch: shared-queue %.3f, work-stealing %.3f\n", sharedAllocations, stealingAllocations);
+    if (sharedAllocations > 0.0 || stealingAllocations > 0.0) {
+        printf("[✗] dispatch allocated\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,25 +3,71 @@
 # === Configuration ===
 CXX=clang++
 CXXFLAGS="-std=c++17 -O2 -Wall -Wextra"
+# per-phase profiler timers, build with PROFILER=0 to compile them out
+if [ "${PROFILER:-1}" = 1 ]; then
+    CXXFLAGS+=" -DENABLE_PROFILER"
+fi
 INCLUDE_DIRS=(
     "src"
     "src/deps/raylib/include"
 )
+# engine sources shared by every target
 SRC_DIRS=(
-    "src"
     "src/Engine"
     "src/utils"
 )
 RAYLIB_LIB="src/deps/raylib/lib/libraylib.a"
 OUT_DIR="bin"
-OUT_BIN="$OUT_DIR/app"
+
+# === Targets ===
+# usage: ./build.sh [app|headless|bench|scenarios|codec]
+# headless targets never draw, so they skip the renderer and don't link raylib
+TARGET="${1:-app}"
+HEADLESS=false
+case "$TARGET" in
+    app)
+        ENTRY_FILES=$(find src -maxdepth 1 -name '*.cpp')
+        OUT_BIN="$OUT_DIR/app"
+        ;;
+    headless)
+        ENTRY_FILES="headless/Headless.cpp"
+        OUT_BIN="$OUT_DIR/headless"
+        HEADLESS=true
+        ;;
+    bench)
+        ENTRY_FILES="bench/ThreadPoolBench.cpp"
+        OUT_BIN="$OUT_DIR/bench_threadpool"
+        HEADLESS=true
+        ;;
+    scenarios)
+        ENTRY_FILES="bench/ScenarioBench.cpp"
+        OUT_BIN="$OUT_DIR/bench_scenarios"
+        HEADLESS=true
+        ;;
+    codec)
+        ENTRY_FILES="bench/CompressionBench.cpp"
+        OUT_BIN="$OUT_DIR/bench_codec"
+        HEADLESS=true
+        ;;
+    *)
+        echo "[✗] Unknown target: $TARGET"
+        exit 1
+        ;;
+esac
 
 # === Platform-specific flags ===
 # PLATFORM_LIBS="-lGL -lm -lpthread -ldl -lrt -lX11" # Linux
 PLATFORM_LIBS="-framework OpenGL -framework Cocoa -framework IOKit -framework CoreVideo" # macOS
+RENDER_FILES="src/Engine/Rendering.cpp
+src/Engine/ParticleRenderer.cpp"
+
+if [ "$HEADLESS" = true ]; then
+    RAYLIB_LIB=""
+    PLATFORM_LIBS="-lpthread"
+fi
 
 # === Build process ===
-echo "[+] Building..."
+echo "[+] Building $TARGET..."
 
 # Gather all .cpp source files
 SRC_FILES=$(
@@ -29,6 +75,10 @@ SRC_FILES=$(
         find "$dir" -name '*.cpp'
     done | sort -u
 )
+if [ "$HEADLESS" = true ]; then
+    SRC_FILES=$(echo "$SRC_FILES" | grep -v -x -F "$RENDER_FILES")
+fi
+SRC_FILES="$ENTRY_FILES $SRC_FILES"
 
 # Construct include flags
 INCLUDE_FLAGS=""
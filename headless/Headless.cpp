@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "Constants.hpp"
+#include "Engine/IntegrationKernels.hpp"
+#include "Engine/Scenes.hpp"
+#include "Engine/Simulation.hpp"
+#include "Engine/VerletEngine.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/TraceRecorder.hpp"
+#include "utils/ThreadPool.hpp"
+
+/// Runs the simulation without a window: same scene and simulation flags as main.cpp
+/// plus Feature::Deterministic, which main.cpp leaves off. Collisions therefore always
+/// take the fixed order lock free strips rather than the app's solver, so the state hash
+/// can be compared across thread counts, but the solver timings are of that path.
+/// Stepped a fixed number of frames at a fixed dt, then prints timings.
+/// Does not touch raylib's window, timing or texture APIs, so it runs on
+/// render-less machines and is free of vsync and drawing noise.
+///
+/// usage: headless [frames] [threads] [seed] [profile.csv] [trace.json]
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    const uint32_t frames = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 600;
+    const size_t threads = argc > 2 ? std::stoul(argv[2]) : 20;
+    const uint32_t seed = argc > 3 ? (uint32_t)std::stoul(argv[3]) : 42;
+    const char* profilePath = argc > 4 ? argv[4] : nullptr;
+    const char* tracePath = argc > 5 ? argv[5] : nullptr;
+
+    FeatureFlags& flags = FeatureFlags::Instance();
+    flags.Enable(Feature::Motion);
+    flags.Enable(Feature::Gravity);
+    flags.Enable(Feature::SpatialHash);
+    flags.Enable(Feature::DenseGrid);
+    flags.Enable(Feature::LockFreeSolve);
+    flags.Enable(Feature::StreamingCollisions);
+    flags.Enable(Feature::IncrementalGrid);
+    flags.Enable(Feature::MultiLevelGrid);
+    flags.Enable(Feature::Sleeping);
+    // same seed, same state hash, whatever the thread count
+    flags.Enable(Feature::Deterministic);
+
+    const uint32_t width = Constants::SCREEN_WIDTH;
+    const uint32_t height = Constants::SCREEN_HEIGHT;
+    mt::ThreadPool threadPool(threads);
+    VerletEngine engine(threadPool);
+    Simulation simulation(engine, width, height);
+    prof::Profiler& profiler = prof::Profiler::Instance();
+    profiler.AttachThreadPool(&threadPool);
+
+    srand(seed);
+    engine.SetSeed(seed);
+    Scenes::SpawnDefault(engine, width, height);
+
+    prof::TraceRecorder& recorder = prof::TraceRecorder::Instance();
+    if (tracePath != nullptr) {
+        recorder.SetThreadName("main");
+        recorder.Start();
+    }
+
+    const float dt = 1.0f / Constants::PREFERRED_FPS;
+    double totalMs = 0.0, minMs = DBL_MAX, maxMs = 0.0;
+    uint64_t steps = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        Clock::time_point start = Clock::now();
+        profiler.BeginFrame();
+        simulation.Advance(dt);
+        profiler.EndFrame();
+        steps += simulation.GetLastFrameSteps();
+        double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        totalMs += frameMs;
+        minMs = std::min(minMs, frameMs);
+        maxMs = std::max(maxMs, frameMs);
+    }
+
+    recorder.Stop();
+
+    const double particleSteps = (double)engine.ParticlesCount() * steps;
+    printf("particles: %zu, static: %zu, threads: %zu, frames: %u, dt: %.5f\n",
+        engine.ParticlesCount(), engine.StaticCollidersCount(), threads, frames, dt);
+    printf("fixed steps: %llu (dt %.5f), dropped frames: %llu\n",
+        (unsigned long long)steps, simulation.GetFixedDt(), (unsigned long long)simulation.GetDroppedFrames());
+    printf("morton reorders: %llu\n", (unsigned long long)engine.GetReordersCount());
+    printf("awake: %zu, asleep: %zu\n", engine.ParticlesCount() - engine.GetAsleepCount(), engine.GetAsleepCount());
+    printf("state hash: %016llx\n", (unsigned long long)engine.ComputeStateHash());
+    printf("integration kernel: %s\n", kernels::IntegrateKernelName());
+    printf("total: %.2f ms\n", totalMs);
+    printf("frame: avg %.3f ms, min %.3f ms, max %.3f ms\n", totalMs / std::max(1u, frames), minMs, maxMs);
+    printf("throughput: %.0f particle steps/s\n", particleSteps / (totalMs / 1000.0));
+
+    // per phase breakdown over the last Profiler::historySize frames
+    if (profiler.FramesCount() > 0) {
+        printf("%-16s %8s %8s %8s\n", "phase", "min ms", "avg ms", "p99 ms");
+        for (uint32_t phase = 0; phase < (uint32_t)prof::Phase::Count; phase++) {
+            prof::PhaseStats stats = profiler.GetPhaseStats((prof::Phase)phase);
+            printf("%-16s %8.3f %8.3f %8.3f\n", prof::PhaseName((prof::Phase)phase), stats.minMs, stats.avgMs, stats.p99Ms);
+        }
+    }
+    const double gridParticles = profiler.GetCounterAverage(prof::Counter::GridParticles);
+    if (gridParticles > 0.0) {
+        printf("grid migrated: %.2f%% per update\n",
+            profiler.GetCounterAverage(prof::Counter::GridMigrations) / gridParticles * 100.0);
+    }
+    const double neighborListBuilds = profiler.GetCounterAverage(prof::Counter::NeighborListBuilds);
+    if (neighborListBuilds > 0.0) {
+        printf("neighbor list builds: %.2f per frame\n", neighborListBuilds);
+    }
+    if (profilePath != nullptr && !profiler.Dump(profilePath)) {
+        fprintf(stderr, "could not write profile to %s\n", profilePath);
+        return EXIT_FAILURE;
+    }
+    if (tracePath != nullptr && !recorder.Write(tracePath)) {
+        fprintf(stderr, "could not write trace to %s\n", tracePath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+#include "FramePipeline.hpp"
+#include "Simulation.hpp"
+#include "VerletEngine.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/TraceRecorder.hpp"
+
+FramePipeline::FramePipeline(Simulation& simulation, VerletEngine& engine)
+    : m_simulation(simulation)
+    , m_engine(engine)
+    , m_thread(&FramePipeline::threadLoop, this)
+    {}
+
+FramePipeline::~FramePipeline() {
+    Finish();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void FramePipeline::Launch(float frameDt) {
+    Finish();
+    if (!FeatureFlags::Instance().IsEnabled(Feature::PipelinedFrames)) {
+        // nothing runs meanwhile, the new frame can be drawn right away
+        simulate(frameDt);
+        m_front ^= 1;
+        return;
+    }
+    m_launched = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameDt = frameDt;
+        m_pending = true;
+    }
+    m_cv.notify_all();
+}
+
+void FramePipeline::Finish() {
+    if (!m_launched) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&] { return !m_pending; });
+    }
+    m_launched = false;
+    m_front ^= 1;
+}
+
+void FramePipeline::Publish(float interpolation) {
+    m_engine.PublishRenderState(m_states[m_front ^ 1], interpolation);
+    m_front ^= 1;
+}
+
+void FramePipeline::simulate(float frameDt) {
+    m_simulation.Advance(frameDt);
+    // the front state may be being drawn, the back one is free until Finish
+    m_engine.PublishRenderState(m_states[m_front ^ 1], m_simulation.GetInterpolation());
+}
+
+void FramePipeline::threadLoop() {
+    prof::TraceRecorder::Instance().SetThreadName("simulation");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [&] { return m_pending || m_stopping; });
+        if (!m_pending) {
+            return;
+        }
+        const float frameDt = m_frameDt;
+        lock.unlock();
+        simulate(frameDt);
+        lock.lock();
+        m_pending = false;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "RenderState.hpp"
+
+class Simulation;
+class VerletEngine;
+
+/// Overlaps drawing a frame with simulating the next one.
+/// Every launched frame advances the simulation and publishes the engine into the
+/// back render state, Finish swaps it to the front. With Feature::PipelinedFrames
+/// that runs on the pipeline's own thread (which drives the thread pool), so the
+/// caller draws Front() meanwhile and a frame costs about max(simulation, render)
+/// instead of their sum, at the price of being drawn one frame later.
+/// Without the feature Launch does all the work and swaps before returning, so the
+/// frame it simulated is the one drawn next, and Finish has nothing to do.
+class FramePipeline {
+public:
+    FramePipeline(Simulation& simulation, VerletEngine& engine);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // advances by `frameDt`. the engine belongs to the pipeline until Finish
+    void Launch(float frameDt);
+
+    // waits for the launched frame and makes it the front state
+    void Finish();
+
+    // publishes the engine as it is into the front state, without stepping.
+    // only between Finish and the next Launch
+    void Publish(float interpolation = 1.0f);
+
+    inline const RenderState& Front() const {
+        return m_states[m_front];
+    }
+
+    // for states that don't come from the engine (replays): fill the back state,
+    // then Swap it to the front. only between Finish and the next Launch
+    inline RenderState& Back() {
+        return m_states[m_front ^ 1];
+    }
+
+    inline void Swap() {
+        m_front ^= 1;
+    }
+
+private:
+    void simulate(float frameDt);
+    void threadLoop();
+
+    Simulation& m_simulation;
+    VerletEngine& m_engine;
+    RenderState m_states[2];
+    size_t m_front = 0;
+    // a launched frame hasn't been finished yet, only used by the caller's thread
+    bool m_launched = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    float m_frameDt = 0.0f;
+    bool m_pending = false;
+    bool m_stopping = false;
+    // last, it starts running in the constructor
+    std::thread m_thread;
+};
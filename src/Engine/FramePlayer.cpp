@@ -0,0 +1,125 @@
+#include <cstring>
+#include "FramePlayer.hpp"
+#include "utils/Compression.hpp"
+
+// larger frames are taken as corrupt rather than allocated
+static constexpr uint64_t maxFrameBytes = (uint64_t)1 << 30;
+
+FramePlayer::~FramePlayer() {
+    Close();
+}
+
+bool FramePlayer::Open(const char* path) {
+    Close();
+    m_file = fopen(path, "rb");
+    if (m_file == nullptr) {
+        return false;
+    }
+    if (fread(&m_header, sizeof(m_header), 1, m_file) != 1
+        || memcmp(m_header.magic, recording::magic, sizeof(recording::magic)) != 0
+        || m_header.version != recording::version
+        || m_header.headerBytes != sizeof(m_header)) {
+        Close();
+        return false;
+    }
+    m_framesRead = 0;
+    m_x.clear();
+    m_y.clear();
+    m_radius.clear();
+    m_color.clear();
+    m_staticX.clear();
+    m_staticY.clear();
+    m_staticRadius.clear();
+    m_staticColor.clear();
+    return true;
+}
+
+void FramePlayer::Close() {
+    if (m_file != nullptr) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+template <typename T>
+static inline const uint8_t* readArray(const uint8_t* in, std::vector<T>& values, size_t count) {
+    const size_t first = values.size();
+    values.resize(first + count);
+    memcpy(values.data() + first, in, count * sizeof(T));
+    return in + count * sizeof(T);
+}
+
+bool FramePlayer::NextFrame() {
+    recording::FrameHeader header;
+    if (!IsOpen() || fread(&header, sizeof(header), 1, m_file) != 1) {
+        return false;
+    }
+    const bool keyFrame = (header.flags & recording::keyFrameFlag) != 0;
+    // a delta frame has to continue exactly where the current one ends
+    const bool valid = header.firstNewParticle <= header.particlesCount
+        && header.firstNewStatic <= header.staticCount
+        && header.rawBytes == recording::RawFrameBytes(header)
+        && header.rawBytes <= maxFrameBytes
+        && header.compressedBytes <= lz::CompressBound(header.rawBytes)
+        && (keyFrame
+            ? header.firstNewParticle == 0 && header.firstNewStatic == 0
+            : header.firstNewParticle == m_x.size() && header.firstNewStatic == m_staticX.size());
+    if (!valid) {
+        return false;
+    }
+    m_compressed.resize(header.compressedBytes);
+    m_raw.resize(header.rawBytes);
+    if (fread(m_compressed.data(), 1, header.compressedBytes, m_file) != header.compressedBytes
+        || !lz::Decompress(m_compressed.data(), header.compressedBytes, m_raw.data(), header.rawBytes)) {
+        return false;
+    }
+
+    if (keyFrame) {
+        m_x.clear();
+        m_y.clear();
+        m_radius.clear();
+        m_color.clear();
+        m_staticX.clear();
+        m_staticY.clear();
+        m_staticRadius.clear();
+        m_staticColor.clear();
+    }
+    const size_t count = header.particlesCount;
+    m_x.resize(count, 0);
+    m_y.resize(count, 0);
+    const uint8_t* planes = m_raw.data();
+    for (size_t i = 0; i < count; i++) {
+        m_x[i] += (uint16_t)(planes[i] | (planes[count + i] << 8));
+        m_y[i] += (uint16_t)(planes[count * 2 + i] | (planes[count * 3 + i] << 8));
+    }
+    const size_t newParticles = count - header.firstNewParticle;
+    const size_t newStatics = header.staticCount - header.firstNewStatic;
+    const uint8_t* in = planes + count * 4;
+    in = readArray(in, m_radius, newParticles);
+    in = readArray(in, m_color, newParticles);
+    in = readArray(in, m_staticX, newStatics);
+    in = readArray(in, m_staticY, newStatics);
+    in = readArray(in, m_staticRadius, newStatics);
+    readArray(in, m_staticColor, newStatics);
+    m_framesRead++;
+    return true;
+}
+
+void FramePlayer::Publish(RenderState& state) const {
+    const size_t count = m_x.size();
+    state.x.resize(count);
+    state.y.resize(count);
+    for (size_t id = 0; id < count; id++) {
+        const Vector2 position = GetPosition(id);
+        state.x[id] = position.x;
+        state.y[id] = position.y;
+    }
+    state.radius.assign(m_radius.begin(), m_radius.end());
+    state.color.assign(m_color.begin(), m_color.end());
+    state.staticX.assign(m_staticX.begin(), m_staticX.end());
+    state.staticY.assign(m_staticY.begin(), m_staticY.end());
+    state.staticRadius.assign(m_staticRadius.begin(), m_staticRadius.end());
+    state.staticColor.assign(m_staticColor.begin(), m_staticColor.end());
+    // sleeping isn't recorded
+    state.asleepCount = 0;
+}
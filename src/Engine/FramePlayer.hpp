@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <raylib.h>
+#include "Recording.hpp"
+#include "RenderState.hpp"
+
+/// Reads back a stream written by FrameRecorder, one frame at a time.
+/// Publish turns the decoded frame into a RenderState, so replays are drawn by
+/// VerletEngine::Draw like a live run while the engine itself is left alone.
+class FramePlayer {
+public:
+    FramePlayer() = default;
+    ~FramePlayer();
+
+    FramePlayer(const FramePlayer&) = delete;
+    FramePlayer& operator=(const FramePlayer&) = delete;
+
+    // false if the file can't be read or isn't a recording of this version
+    bool Open(const char* path);
+    void Close();
+
+    inline bool IsOpen() const {
+        return m_file != nullptr;
+    }
+
+    // decodes the next frame, false at the end of the stream or on a corrupt frame
+    bool NextFrame();
+
+    // copies the current frame into `state`, replacing whatever it held
+    void Publish(RenderState& state) const;
+
+    inline uint64_t FramesRead() const {
+        return m_framesRead;
+    }
+
+    inline size_t ParticlesCount() const {
+        return m_x.size();
+    }
+
+    inline Vector2 GetPosition(size_t id) const {
+        return Vector2 {
+            recording::Dequantize(m_x[id], m_header.worldWidth),
+            recording::Dequantize(m_y[id], m_header.worldHeight)
+        };
+    }
+
+private:
+    FILE* m_file = nullptr;
+    recording::FileHeader m_header = {};
+    uint64_t m_framesRead = 0;
+
+    // current frame, in particle id order
+    std::vector<uint16_t> m_x, m_y;
+    std::vector<float> m_radius;
+    std::vector<Color> m_color;
+    std::vector<float> m_staticX, m_staticY, m_staticRadius;
+    std::vector<Color> m_staticColor;
+
+    std::vector<uint8_t> m_raw, m_compressed;
+};
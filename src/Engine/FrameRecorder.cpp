@@ -0,0 +1,199 @@
+#include <cstring>
+#include "FrameRecorder.hpp"
+#include "VerletEngine.hpp"
+#include "utils/Compression.hpp"
+
+FrameRecorder::~FrameRecorder() {
+    if (IsRecording()) {
+        Stop();
+    }
+}
+
+bool FrameRecorder::Start(const char* path, float worldWidth, float worldHeight) {
+    if (IsRecording()) {
+        Stop();
+    }
+    m_file = fopen(path, "wb");
+    if (m_file == nullptr) {
+        return false;
+    }
+    recording::FileHeader header = {};
+    memcpy(header.magic, recording::magic, sizeof(recording::magic));
+    header.version = recording::version;
+    header.headerBytes = sizeof(header);
+    header.worldWidth = worldWidth;
+    header.worldHeight = worldHeight;
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    m_worldWidth = worldWidth;
+    m_worldHeight = worldHeight;
+    m_queuedAny = false;
+    m_queuedParticles = m_queuedStatics = 0;
+    m_framesDropped = 0;
+    m_framesWritten = 0;
+    m_failed = false;
+    m_stopping = false;
+    m_writer = std::thread(&FrameRecorder::writerLoop, this);
+    return true;
+}
+
+bool FrameRecorder::Stop() {
+    if (!IsRecording()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_writer.join();
+    const bool closed = fclose(m_file) == 0;
+    m_file = nullptr;
+    return closed && !m_failed;
+}
+
+void FrameRecorder::Capture(VerletEngine& engine) {
+    if (!IsRecording() || m_failed) {
+        return;
+    }
+    std::unique_ptr<CapturedFrame> frame;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= maxQueuedFrames) {
+            m_framesDropped++;
+            return;
+        }
+        if (!m_free.empty()) {
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+    if (!frame) {
+        frame = std::make_unique<CapturedFrame>();
+    }
+
+    const uint32_t count = (uint32_t)engine.ParticlesCount();
+    const StaticColliders& statics = engine.GetStaticColliders();
+    const uint32_t staticCount = (uint32_t)statics.Size();
+    // between generations particles only get added, anything else replaced the scene
+    const uint64_t generation = engine.GetGeneration();
+    const bool keyFrame = !m_queuedAny || generation != m_queuedGeneration
+        || count < m_queuedParticles || staticCount < m_queuedStatics;
+    recording::FrameHeader& header = frame->header;
+    header = recording::FrameHeader {};
+    header.flags = keyFrame ? recording::keyFrameFlag : 0;
+    header.particlesCount = count;
+    header.firstNewParticle = keyFrame ? 0 : m_queuedParticles;
+    header.staticCount = staticCount;
+    header.firstNewStatic = keyFrame ? 0 : m_queuedStatics;
+
+    frame->x.resize(count);
+    frame->y.resize(count);
+    frame->newRadius.clear();
+    frame->newColor.clear();
+    for (uint32_t id = 0; id < count; id++) {
+        const Particle particle = engine.GetParticleById(id);
+        const Vector2 position = particle.GetPosition();
+        frame->x[id] = recording::Quantize(position.x, m_worldWidth);
+        frame->y[id] = recording::Quantize(position.y, m_worldHeight);
+        if (id >= header.firstNewParticle) {
+            frame->newRadius.push_back(particle.GetRadius());
+            frame->newColor.push_back(particle.GetColor());
+        }
+    }
+    frame->newStaticX.clear();
+    frame->newStaticY.clear();
+    frame->newStaticRadius.clear();
+    frame->newStaticColor.clear();
+    for (uint32_t i = header.firstNewStatic; i < staticCount; i++) {
+        const Vector2 position = statics.GetPosition(i);
+        frame->newStaticX.push_back(position.x);
+        frame->newStaticY.push_back(position.y);
+        frame->newStaticRadius.push_back(statics.GetRadius(i));
+        frame->newStaticColor.push_back(statics.GetColor(i));
+    }
+
+    m_queuedAny = true;
+    m_queuedGeneration = generation;
+    m_queuedParticles = count;
+    m_queuedStatics = staticCount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(std::move(frame));
+    }
+    m_cv.notify_one();
+}
+
+void FrameRecorder::writerLoop() {
+    while (true) {
+        std::unique_ptr<CapturedFrame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return !m_queue.empty() || m_stopping; });
+            if (m_queue.empty()) {
+                return;
+            }
+            frame = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        if (!m_failed && !writeFrame(*frame)) {
+            m_failed = true;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(std::move(frame));
+    }
+}
+
+template <typename T>
+static inline uint8_t* appendArray(uint8_t* out, const std::vector<T>& values) {
+    memcpy(out, values.data(), values.size() * sizeof(T));
+    return out + values.size() * sizeof(T);
+}
+
+bool FrameRecorder::writeFrame(CapturedFrame& frame) {
+    recording::FrameHeader header = frame.header;
+    const size_t count = header.particlesCount;
+    if (header.flags & recording::keyFrameFlag) {
+        m_previousX.assign(count, 0);
+        m_previousY.assign(count, 0);
+    } else {
+        // new particles are stored against 0, their absolute position
+        m_previousX.resize(count, 0);
+        m_previousY.resize(count, 0);
+    }
+
+    m_raw.resize(recording::RawFrameBytes(header));
+    uint8_t* planes = m_raw.data();
+    for (size_t i = 0; i < count; i++) {
+        // wraps around, the player adds it back the same way
+        const uint16_t dx = (uint16_t)(frame.x[i] - m_previousX[i]);
+        const uint16_t dy = (uint16_t)(frame.y[i] - m_previousY[i]);
+        planes[i] = (uint8_t)dx;
+        planes[count + i] = (uint8_t)(dx >> 8);
+        planes[count * 2 + i] = (uint8_t)dy;
+        planes[count * 3 + i] = (uint8_t)(dy >> 8);
+    }
+    uint8_t* out = planes + count * 4;
+    out = appendArray(out, frame.newRadius);
+    out = appendArray(out, frame.newColor);
+    out = appendArray(out, frame.newStaticX);
+    out = appendArray(out, frame.newStaticY);
+    out = appendArray(out, frame.newStaticRadius);
+    appendArray(out, frame.newStaticColor);
+    m_previousX.swap(frame.x);
+    m_previousY.swap(frame.y);
+
+    m_compressed.resize(lz::CompressBound(m_raw.size()));
+    header.rawBytes = (uint32_t)m_raw.size();
+    header.compressedBytes = (uint32_t)lz::Compress(m_raw.data(), m_raw.size(), m_compressed.data());
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1
+        || fwrite(m_compressed.data(), 1, header.compressedBytes, m_file) != header.compressedBytes) {
+        return false;
+    }
+    m_framesWritten.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
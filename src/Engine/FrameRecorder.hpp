@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <raylib.h>
+#include "Recording.hpp"
+
+class VerletEngine;
+
+/// Streams the particle positions of every captured frame to disk (see Recording.hpp).
+/// Capture only quantizes the positions into a pooled buffer and queues it, a
+/// background thread takes care of the deltas, the compression and the writes, so
+/// the simulation never waits on the disk. When the disk falls behind by more than
+/// maxQueuedFrames, Capture drops the frame instead of blocking; the next one is
+/// simply stored against the last frame that made it.
+class FrameRecorder {
+public:
+    static constexpr size_t maxQueuedFrames = 8;
+
+    FrameRecorder() = default;
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // opens `path` and starts the writer thread, false if the file can't be created
+    bool Start(const char* path, float worldWidth, float worldHeight);
+    // writes what is still queued and closes the file, false if any write failed
+    bool Stop();
+
+    inline bool IsRecording() const {
+        return m_writer.joinable();
+    }
+
+    // call between frames, while the engine's workers are idle
+    void Capture(VerletEngine& engine);
+
+    inline uint64_t FramesWritten() const {
+        return m_framesWritten.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t FramesDropped() const {
+        return m_framesDropped;
+    }
+
+private:
+    // what Capture hands over, only what changed besides the positions
+    struct CapturedFrame {
+        recording::FrameHeader header;
+        std::vector<uint16_t> x, y;
+        std::vector<float> newRadius;
+        std::vector<Color> newColor;
+        std::vector<float> newStaticX, newStaticY, newStaticRadius;
+        std::vector<Color> newStaticColor;
+    };
+
+    void writerLoop();
+    bool writeFrame(CapturedFrame& frame);
+
+    FILE* m_file = nullptr;
+    float m_worldWidth = 0.0f;
+    float m_worldHeight = 0.0f;
+
+    // sim thread side: counts of the last queued frame
+    uint32_t m_queuedParticles = 0;
+    uint32_t m_queuedStatics = 0;
+    bool m_queuedAny = false;
+    uint64_t m_queuedGeneration = 0;
+    uint64_t m_framesDropped = 0;
+
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::unique_ptr<CapturedFrame>> m_queue;
+    // buffers go back here once written, in steady state nothing is allocated
+    std::vector<std::unique_ptr<CapturedFrame>> m_free;
+    bool m_stopping = false;
+    std::atomic<bool> m_failed = { false };
+    std::atomic<uint64_t> m_framesWritten = { 0 };
+
+    // writer thread side: positions of the last written frame and scratch buffers
+    std::vector<uint16_t> m_previousX, m_previousY;
+    std::vector<uint8_t> m_raw, m_compressed;
+};
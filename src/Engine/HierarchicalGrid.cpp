@@ -0,0 +1,36 @@
+#include <algorithm>
+#include "HierarchicalGrid.hpp"
+
+void HierarchicalGrid::Build(const ParticleStore& particles, float minRadius, float maxRadius) {
+    const size_t count = particles.Size();
+    m_levelsCount = 1;
+    m_levelCellSize[0] = minRadius * 2;
+    while (m_levelsCount < maxLevels && m_levelCellSize[m_levelsCount - 1] < maxRadius * 2) {
+        m_levelCellSize[m_levelsCount] = m_levelCellSize[m_levelsCount - 1] * 2;
+        m_levelsCount++;
+    }
+    // out of levels, the top one takes whatever is left
+    m_levelCellSize[m_levelsCount - 1] = std::max(m_levelCellSize[m_levelsCount - 1], maxRadius * 2);
+
+    for (uint32_t level = 0; level < maxLevels; level++) {
+        m_levelParticles[level].clear();
+        m_levelX[level].clear();
+        m_levelY[level].clear();
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float diameter = particles.radius[i] * 2;
+        uint32_t level = 0;
+        while (level + 1 < m_levelsCount && m_levelCellSize[level] < diameter) {
+            level++;
+        }
+        m_levelParticles[level].push_back((uint32_t)i);
+        m_levelX[level].push_back(particles.x[i]);
+        m_levelY[level].push_back(particles.y[i]);
+    }
+
+    for (uint32_t level = 0; level < m_levelsCount; level++) {
+        m_levels[level].Build(
+            m_levelX[level].data(), m_levelY[level].data(), m_levelParticles[level].size(), m_levelCellSize[level]
+        );
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.hpp"
+#include "UniformGrid.hpp"
+
+/// Stack of dense grids for particles of very different sizes.
+/// Level 0 cells fit the smallest particle, every level above doubles the cell
+/// size, and each particle is binned into the first level whose cells fit it.
+/// A particle only looks for partners in its own level (half stencil) and in the
+/// 3x3 cells around it in every coarser level, so one huge particle no longer
+/// inflates the cells, and the candidate count, of all the small ones.
+class HierarchicalGrid {
+public:
+    // 2^7 = 128x between the smallest and largest radius before the top level
+    // has to stretch its cells
+    static constexpr uint32_t maxLevels = 8;
+
+    void Build(const ParticleStore& particles, float minRadius, float maxRadius);
+
+    inline uint32_t LevelsCount() const {
+        return m_levelsCount;
+    }
+
+    inline size_t LevelSize(uint32_t level) const {
+        return m_levelParticles[level].size();
+    }
+
+    // particle store index of the `local`-th particle of a level
+    inline uint32_t ParticleIndex(uint32_t level, uint32_t local) const {
+        return m_levelParticles[level][local];
+    }
+
+    // calls visit(particleIndex) for every particle that may touch the given one
+    // and was not, or will not be, visited from the other side
+    template <typename Visit>
+    void ForEachCandidate(uint32_t level, uint32_t local, Visit visit) const;
+
+private:
+    uint32_t m_levelsCount = 0;
+    float m_levelCellSize[maxLevels] = {};
+    UniformGrid m_levels[maxLevels];
+    std::vector<uint32_t> m_levelParticles[maxLevels];
+    std::vector<float> m_levelX[maxLevels], m_levelY[maxLevels];
+
+    // same half of the neighborhood as VerletEngine's dense grid walks
+    static constexpr int32_t HALF_DIR_X[4] = { 1, 1, 1, 0 };
+    static constexpr int32_t HALF_DIR_Y[4] = { -1, 0, 1, 1 };
+};
+
+template <typename Visit>
+void HierarchicalGrid::ForEachCandidate(uint32_t level, uint32_t local, Visit visit) const {
+    const UniformGrid& grid = m_levels[level];
+    const uint32_t* levelParticles = m_levelParticles[level].data();
+    const uint32_t cell = grid.ParticleCell(local);
+    const int32_t cx = (int32_t)(cell % grid.Columns());
+    const int32_t cy = (int32_t)(cell / grid.Columns());
+    const uint32_t* sorted = grid.SortedIndices();
+
+    // own cell, every pair once from its lower index
+    for (uint32_t slot = grid.CellStart(cell), end = slot + grid.CellCount(cell); slot < end; slot++) {
+        if (sorted[slot] > local) {
+            visit(levelParticles[sorted[slot]]);
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        const int32_t nx = cx + HALF_DIR_X[d];
+        const int32_t ny = cy + HALF_DIR_Y[d];
+        if (!grid.IsInside(nx, ny)) {
+            continue;
+        }
+        const size_t neighbor = grid.CellIndex(nx, ny);
+        for (uint32_t slot = grid.CellStart(neighbor), end = slot + grid.CellCount(neighbor); slot < end; slot++) {
+            visit(levelParticles[sorted[slot]]);
+        }
+    }
+
+    // coarser levels, their particles never look down so the full 3x3 is walked here
+    const float x = m_levelX[level][local], y = m_levelY[level][local];
+    for (uint32_t upper = level + 1; upper < m_levelsCount; upper++) {
+        const UniformGrid& upperGrid = m_levels[upper];
+        if (upperGrid.Columns() == 0) {
+            continue;
+        }
+        const uint32_t* upperParticles = m_levelParticles[upper].data();
+        const uint32_t* upperSorted = upperGrid.SortedIndices();
+        const int32_t ux = upperGrid.CellX(x);
+        const int32_t uy = upperGrid.CellY(y);
+        for (int32_t ny = uy - 1; ny <= uy + 1; ny++) {
+            for (int32_t nx = ux - 1; nx <= ux + 1; nx++) {
+                if (!upperGrid.IsInside(nx, ny)) {
+                    continue;
+                }
+                const size_t neighbor = upperGrid.CellIndex(nx, ny);
+                for (uint32_t slot = upperGrid.CellStart(neighbor), end = slot + upperGrid.CellCount(neighbor); slot < end; slot++) {
+                    visit(upperParticles[upperSorted[slot]]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#include <cstring>
+#include "IntegrationKernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VERLET_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define VERLET_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace kernels {
+
+// the math is split over statements on purpose, so the compiler doesn't contract it
+// into FMAs and the scalar tail matches the vector lanes bit for bit
+void IntegrateScalar(ParticleStore& particles, size_t begin, size_t end, const Vector2& acceleration, float dt) {
+    float* x = particles.x.data();
+    float* y = particles.y.data();
+    float* oldX = particles.oldX.data();
+    float* oldY = particles.oldY.data();
+    float* ax = particles.ax.data();
+    float* ay = particles.ay.data();
+    const uint8_t* particleFlags = particles.flags.data();
+    const float dt2 = dt * dt;
+    for (size_t i = begin; i < end; i++) {
+        // fixed and sleeping particles stay put
+        if (particleFlags[i] != 0) {
+            continue;
+        }
+        const float velocityX = x[i] - oldX[i];
+        const float velocityY = y[i] - oldY[i];
+        const float stepX = (ax[i] + acceleration.x) * dt2;
+        const float stepY = (ay[i] + acceleration.y) * dt2;
+        oldX[i] = x[i];
+        oldY[i] = y[i];
+        x[i] += velocityX + stepX;
+        y[i] += velocityY + stepY;
+        // reset acceleration
+        ax[i] = 0.0f;
+        ay[i] = 0.0f;
+    }
+}
+
+#ifdef VERLET_X86
+
+__attribute__((target("avx2")))
+static void integrateAvx2(ParticleStore& particles, size_t begin, size_t end, const Vector2& acceleration, float dt) {
+    float* x = particles.x.data();
+    float* y = particles.y.data();
+    float* oldX = particles.oldX.data();
+    float* oldY = particles.oldY.data();
+    float* ax = particles.ax.data();
+    float* ay = particles.ay.data();
+    const uint8_t* particleFlags = particles.flags.data();
+
+    const __m256 dt2 = _mm256_set1_ps(dt * dt);
+    const __m256 accelerationX = _mm256_set1_ps(acceleration.x);
+    const __m256 accelerationY = _mm256_set1_ps(acceleration.y);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        // 8 fixed flags -> 8 lane masks
+        int64_t flags;
+        memcpy(&flags, particleFlags + i, sizeof(flags));
+        const __m256i fixed32 = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(flags));
+        const __m256 fixedMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(fixed32, _mm256_setzero_si256()));
+
+        const __m256 px = _mm256_loadu_ps(x + i);
+        const __m256 py = _mm256_loadu_ps(y + i);
+        const __m256 ox = _mm256_loadu_ps(oldX + i);
+        const __m256 oy = _mm256_loadu_ps(oldY + i);
+        const __m256 pax = _mm256_loadu_ps(ax + i);
+        const __m256 pay = _mm256_loadu_ps(ay + i);
+        const __m256 stepX = _mm256_mul_ps(_mm256_add_ps(pax, accelerationX), dt2);
+        const __m256 stepY = _mm256_mul_ps(_mm256_add_ps(pay, accelerationY), dt2);
+        const __m256 nx = _mm256_add_ps(px, _mm256_add_ps(_mm256_sub_ps(px, ox), stepX));
+        const __m256 ny = _mm256_add_ps(py, _mm256_add_ps(_mm256_sub_ps(py, oy), stepY));
+
+        // fixed lanes keep their old values
+        _mm256_storeu_ps(x + i, _mm256_blendv_ps(nx, px, fixedMask));
+        _mm256_storeu_ps(y + i, _mm256_blendv_ps(ny, py, fixedMask));
+        _mm256_storeu_ps(oldX + i, _mm256_blendv_ps(px, ox, fixedMask));
+        _mm256_storeu_ps(oldY + i, _mm256_blendv_ps(py, oy, fixedMask));
+        _mm256_storeu_ps(ax + i, _mm256_blendv_ps(zero, pax, fixedMask));
+        _mm256_storeu_ps(ay + i, _mm256_blendv_ps(zero, pay, fixedMask));
+    }
+    IntegrateScalar(particles, i, end, acceleration, dt);
+}
+
+static inline __m128 selectSse2(__m128 mask, __m128 ifSet, __m128 ifClear) {
+    return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+}
+
+static void integrateSse2(ParticleStore& particles, size_t begin, size_t end, const Vector2& acceleration, float dt) {
+    float* x = particles.x.data();
+    float* y = particles.y.data();
+    float* oldX = particles.oldX.data();
+    float* oldY = particles.oldY.data();
+    float* ax = particles.ax.data();
+    float* ay = particles.ay.data();
+    const uint8_t* particleFlags = particles.flags.data();
+
+    const __m128 dt2 = _mm_set1_ps(dt * dt);
+    const __m128 accelerationX = _mm_set1_ps(acceleration.x);
+    const __m128 accelerationY = _mm_set1_ps(acceleration.y);
+    const __m128i zeroInt = _mm_setzero_si128();
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        // 4 fixed flags -> 4 lane masks
+        int32_t flags;
+        memcpy(&flags, particleFlags + i, sizeof(flags));
+        __m128i fixed32 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(flags), zeroInt);
+        fixed32 = _mm_unpacklo_epi16(fixed32, zeroInt);
+        const __m128 fixedMask = _mm_castsi128_ps(_mm_cmpgt_epi32(fixed32, zeroInt));
+
+        const __m128 px = _mm_loadu_ps(x + i);
+        const __m128 py = _mm_loadu_ps(y + i);
+        const __m128 ox = _mm_loadu_ps(oldX + i);
+        const __m128 oy = _mm_loadu_ps(oldY + i);
+        const __m128 pax = _mm_loadu_ps(ax + i);
+        const __m128 pay = _mm_loadu_ps(ay + i);
+        const __m128 stepX = _mm_mul_ps(_mm_add_ps(pax, accelerationX), dt2);
+        const __m128 stepY = _mm_mul_ps(_mm_add_ps(pay, accelerationY), dt2);
+        const __m128 nx = _mm_add_ps(px, _mm_add_ps(_mm_sub_ps(px, ox), stepX));
+        const __m128 ny = _mm_add_ps(py, _mm_add_ps(_mm_sub_ps(py, oy), stepY));
+
+        _mm_storeu_ps(x + i, selectSse2(fixedMask, px, nx));
+        _mm_storeu_ps(y + i, selectSse2(fixedMask, py, ny));
+        _mm_storeu_ps(oldX + i, selectSse2(fixedMask, ox, px));
+        _mm_storeu_ps(oldY + i, selectSse2(fixedMask, oy, py));
+        _mm_storeu_ps(ax + i, _mm_and_ps(fixedMask, pax));
+        _mm_storeu_ps(ay + i, _mm_and_ps(fixedMask, pay));
+    }
+    IntegrateScalar(particles, i, end, acceleration, dt);
+}
+
+#endif // VERLET_X86
+
+#ifdef VERLET_NEON
+
+static void integrateNeon(ParticleStore& particles, size_t begin, size_t end, const Vector2& acceleration, float dt) {
+    float* x = particles.x.data();
+    float* y = particles.y.data();
+    float* oldX = particles.oldX.data();
+    float* oldY = particles.oldY.data();
+    float* ax = particles.ax.data();
+    float* ay = particles.ay.data();
+    const uint8_t* particleFlags = particles.flags.data();
+
+    const float32x4_t dt2 = vdupq_n_f32(dt * dt);
+    const float32x4_t accelerationX = vdupq_n_f32(acceleration.x);
+    const float32x4_t accelerationY = vdupq_n_f32(acceleration.y);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        // 4 fixed flags -> 4 lane masks
+        const uint32_t flags[4] = { particleFlags[i], particleFlags[i + 1], particleFlags[i + 2], particleFlags[i + 3] };
+        const uint32x4_t fixedMask = vcgtq_u32(vld1q_u32(flags), vdupq_n_u32(0));
+
+        const float32x4_t px = vld1q_f32(x + i);
+        const float32x4_t py = vld1q_f32(y + i);
+        const float32x4_t ox = vld1q_f32(oldX + i);
+        const float32x4_t oy = vld1q_f32(oldY + i);
+        const float32x4_t pax = vld1q_f32(ax + i);
+        const float32x4_t pay = vld1q_f32(ay + i);
+        const float32x4_t stepX = vmulq_f32(vaddq_f32(pax, accelerationX), dt2);
+        const float32x4_t stepY = vmulq_f32(vaddq_f32(pay, accelerationY), dt2);
+        const float32x4_t nx = vaddq_f32(px, vaddq_f32(vsubq_f32(px, ox), stepX));
+        const float32x4_t ny = vaddq_f32(py, vaddq_f32(vsubq_f32(py, oy), stepY));
+
+        vst1q_f32(x + i, vbslq_f32(fixedMask, px, nx));
+        vst1q_f32(y + i, vbslq_f32(fixedMask, py, ny));
+        vst1q_f32(oldX + i, vbslq_f32(fixedMask, ox, px));
+        vst1q_f32(oldY + i, vbslq_f32(fixedMask, oy, py));
+        vst1q_f32(ax + i, vbslq_f32(fixedMask, pax, zero));
+        vst1q_f32(ay + i, vbslq_f32(fixedMask, pay, zero));
+    }
+    IntegrateScalar(particles, i, end, acceleration, dt);
+}
+
+#endif // VERLET_NEON
+
+struct SelectedKernel {
+    IntegrateKernel kernel;
+    const char* name;
+};
+
+static SelectedKernel selectKernel() {
+#if defined(VERLET_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        return SelectedKernel { integrateAvx2, "avx2" };
+    }
+    return SelectedKernel { integrateSse2, "sse2" };
+#elif defined(VERLET_NEON)
+    return SelectedKernel { integrateNeon, "neon" };
+#else
+    return SelectedKernel { IntegrateScalar, "scalar" };
+#endif
+}
+
+static const SelectedKernel& selectedKernel() {
+    static const SelectedKernel selected = selectKernel();
+    return selected;
+}
+
+IntegrateKernel SelectIntegrateKernel() {
+    return selectedKernel().kernel;
+}
+
+const char* IntegrateKernelName() {
+    return selectedKernel().name;
+}
+
+} // namespace kernels
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <raylib.h>
+#include "ParticleStore.hpp"
+
+/// Verlet integration kernels over the ParticleStore arrays.
+/// All kernels compute the same thing for particles [begin, end):
+///     x' = x + (x - oldX) + (ax + acceleration.x) * dt^2, oldX' = x, ax' = 0
+/// and leave fixed particles untouched (masked with a blend, not a branch).
+/// The best kernel for the running CPU is picked once at runtime, so the same
+/// binary runs on machines without AVX2.
+namespace kernels {
+    using IntegrateKernel = void (*)(
+        ParticleStore& particles,
+        size_t begin,
+        size_t end,
+        const Vector2& acceleration,
+        float dt
+    );
+
+    // AVX2 (8 lanes) > SSE2 / NEON (4 lanes) > scalar
+    IntegrateKernel SelectIntegrateKernel();
+    const char* IntegrateKernelName();
+
+    void IntegrateScalar(ParticleStore& particles, size_t begin, size_t end, const Vector2& acceleration, float dt);
+}
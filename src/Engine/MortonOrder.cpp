@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <mutex>
+#include "MortonOrder.hpp"
+
+void MortonOrder::Sort(const float* xs, const float* ys, size_t count, float cellSize, mt::ThreadPool& threadPool) {
+    m_keys.resize(count);
+    m_keysScratch.resize(count);
+    m_order.resize(count);
+    m_orderScratch.resize(count);
+    if (count == 0) {
+        return;
+    }
+
+    // every pass scatters chunk by chunk, more chunks than workers only adds prefix work
+    m_chunksCount = std::max<size_t>(1, std::min<size_t>(threadPool.threadCount, count));
+    m_histograms.resize(m_chunksCount * bucketsCount);
+
+    const float invCellSize = 1.0f / cellSize;
+    uint32_t maxKey = 0;
+    std::mutex maxKeyMutex;
+    threadPool.dispatch(count, [&](size_t start, size_t end) {
+        uint32_t localMax = 0;
+        for (size_t i = start; i < end; i++) {
+            // 16 bits per axis is plenty for cells of a screen sized world
+            const float cx = std::clamp(xs[i] * invCellSize, 0.0f, 65535.0f);
+            const float cy = std::clamp(ys[i] * invCellSize, 0.0f, 65535.0f);
+            m_keys[i] = Encode((uint32_t)cx, (uint32_t)cy);
+            m_order[i] = (uint32_t)i;
+            localMax = std::max(localMax, m_keys[i]);
+        }
+        std::lock_guard<std::mutex> lock(maxKeyMutex);
+        maxKey = std::max(maxKey, localMax);
+    });
+
+    // high digits are all zero for small worlds, those passes would only copy
+    for (uint32_t shift = 0; shift < 32 && (maxKey >> shift) != 0; shift += radixBits) {
+        radixPass(count, shift, threadPool);
+    }
+}
+
+void MortonOrder::radixPass(size_t count, uint32_t shift, mt::ThreadPool& threadPool) {
+    // 1. per chunk digit histograms
+    threadPool.dispatch(m_chunksCount, [&](size_t start, size_t end) {
+        for (size_t chunk = start; chunk < end; chunk++) {
+            uint32_t* histogram = &m_histograms[chunk * bucketsCount];
+            std::fill(histogram, histogram + bucketsCount, 0u);
+            for (size_t i = chunkBegin(chunk, count), e = chunkBegin(chunk + 1, count); i < e; i++) {
+                histogram[(m_keys[i] >> shift) & (bucketsCount - 1)]++;
+            }
+        }
+    }, 1);
+
+    // 2. exclusive prefix sum digit major, chunk minor, turns counts into scatter offsets
+    uint32_t offset = 0;
+    for (uint32_t bucket = 0; bucket < bucketsCount; bucket++) {
+        for (size_t chunk = 0; chunk < m_chunksCount; chunk++) {
+            uint32_t& slot = m_histograms[chunk * bucketsCount + bucket];
+            const uint32_t bucketCount = slot;
+            slot = offset;
+            offset += bucketCount;
+        }
+    }
+
+    // 3. every chunk scatters its slice in order, so equal digits keep their relative order
+    threadPool.dispatch(m_chunksCount, [&](size_t start, size_t end) {
+        for (size_t chunk = start; chunk < end; chunk++) {
+            uint32_t* cursor = &m_histograms[chunk * bucketsCount];
+            for (size_t i = chunkBegin(chunk, count), e = chunkBegin(chunk + 1, count); i < e; i++) {
+                const uint32_t slot = cursor[(m_keys[i] >> shift) & (bucketsCount - 1)]++;
+                m_keysScratch[slot] = m_keys[i];
+                m_orderScratch[slot] = m_order[i];
+            }
+        }
+    }, 1);
+
+    m_keys.swap(m_keysScratch);
+    m_order.swap(m_orderScratch);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utils/ThreadPool.hpp"
+
+/// Orders particles along a Morton (Z-order) curve of their grid cell.
+/// Every particle gets a 32 bit key interleaving its 16 bit cell coordinates,
+/// keys are LSD radix sorted 8 bits per pass on the thread pool, and the
+/// resulting permutation is what the engine uses to shuffle its arrays, so
+/// particles that are close in space end up close in memory.
+/// Buffers are kept between sorts and only grow.
+class MortonOrder {
+public:
+    static constexpr uint32_t radixBits = 8;
+    static constexpr uint32_t bucketsCount = 1u << radixBits;
+
+    // interleaves the bits of x and y, x ends up in the even bits
+    static inline uint32_t Encode(uint32_t x, uint32_t y) {
+        return spreadBits(x) | (spreadBits(y) << 1);
+    }
+
+    void Sort(const float* xs, const float* ys, size_t count, float cellSize, mt::ThreadPool& threadPool);
+
+    // order[i] is the old index of the particle that goes to slot i
+    inline const uint32_t* Order() const {
+        return m_order.data();
+    }
+
+private:
+    // one chunk per worker, each chunk scatters its own slice so the sort stays stable
+    size_t m_chunksCount = 0;
+    std::vector<uint32_t> m_keys, m_keysScratch;
+    std::vector<uint32_t> m_order, m_orderScratch;
+    std::vector<uint32_t> m_histograms;
+
+    static inline uint32_t spreadBits(uint32_t value) {
+        value &= 0x0000FFFF;
+        value = (value | (value << 8)) & 0x00FF00FF;
+        value = (value | (value << 4)) & 0x0F0F0F0F;
+        value = (value | (value << 2)) & 0x33333333;
+        value = (value | (value << 1)) & 0x55555555;
+        return value;
+    }
+
+    inline size_t chunkBegin(size_t chunk, size_t count) const {
+        return count * chunk / m_chunksCount;
+    }
+
+    void radixPass(size_t count, uint32_t shift, mt::ThreadPool& threadPool);
+};
@@ -0,0 +1,109 @@
+#include <atomic>
+#include "NeighborList.hpp"
+
+void NeighborList::Build(const ParticleStore& particles, float maxRadius, float skin, mt::ThreadPool& threadPool) {
+    const size_t count = particles.Size();
+    m_skin = skin;
+    m_builtX.assign(particles.x.begin(), particles.x.end());
+    m_builtY.assign(particles.y.begin(), particles.y.end());
+    m_neighborStart.assign(count + 1, 0);
+    // a cell has to hold anything within reach of the largest pair plus the skin
+    m_grid.Build(particles.x.data(), particles.y.data(), count, maxRadius * 2 + skin);
+    m_cellX.resize(count);
+    m_cellY.resize(count);
+    m_cellRadius.resize(count);
+    m_cellFixed.resize(count);
+    const uint32_t* sorted = m_grid.SortedIndices();
+    threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t slot = start; slot < end; slot++) {
+            const uint32_t i = sorted[slot];
+            m_cellX[slot] = particles.x[i];
+            m_cellY[slot] = particles.y[i];
+            m_cellRadius[slot] = particles.radius[i];
+            // sleepers wake up, only pinned particles can be left out for good
+            m_cellFixed[slot] = particles.flags[i] & ParticleStore::fixedFlag;
+        }
+    });
+
+    // 1. count the neighbors of every particle
+    threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            uint32_t neighborsCount = 0;
+            forEachNeighbor(particles, i, [&](uint32_t) {
+                neighborsCount++;
+            });
+            m_neighborStart[i + 1] = neighborsCount;
+        }
+    });
+
+    // 2. prefix sum gives every list its offset
+    for (size_t i = 0; i < count; i++) {
+        m_neighborStart[i + 1] += m_neighborStart[i];
+    }
+    m_neighbors.resize(m_neighborStart[count]);
+
+    // 3. fill the lists, the walk visits neighbors in the same order as the count
+    threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            uint32_t* neighbors = &m_neighbors[m_neighborStart[i]];
+            forEachNeighbor(particles, i, [&](uint32_t j) {
+                *neighbors++ = j;
+            });
+        }
+    });
+    m_valid = true;
+    m_buildsCount++;
+}
+
+bool NeighborList::NeedsRebuild(const ParticleStore& particles, mt::ThreadPool& threadPool) const {
+    const size_t count = particles.Size();
+    if (!m_valid || count != m_builtX.size()) {
+        return true;
+    }
+    const float limit = m_skin * 0.5f;
+    const float limitSquared = limit * limit;
+    std::atomic<bool> moved = { false };
+    threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end && !moved.load(std::memory_order_relaxed); i++) {
+            const float dx = particles.x[i] - m_builtX[i];
+            const float dy = particles.y[i] - m_builtY[i];
+            if (dx * dx + dy * dy > limitSquared) {
+                moved.store(true, std::memory_order_relaxed);
+            }
+        }
+    });
+    return moved;
+}
+
+template <typename Visit>
+void NeighborList::forEachNeighbor(const ParticleStore& particles, size_t index, Visit visit) const {
+    const uint32_t cell = m_grid.ParticleCell(index);
+    const int32_t cx = (int32_t)(cell % m_grid.Columns());
+    const int32_t cy = (int32_t)(cell / m_grid.Columns());
+    const uint32_t* sorted = m_grid.SortedIndices();
+    const float x = particles.x[index], y = particles.y[index];
+    const float radius = particles.radius[index];
+    const bool fixed = (particles.flags[index] & ParticleStore::fixedFlag) != 0;
+
+    for (int32_t ny = cy - 1; ny <= cy + 1; ny++) {
+        for (int32_t nx = cx - 1; nx <= cx + 1; nx++) {
+            if (!m_grid.IsInside(nx, ny)) {
+                continue;
+            }
+            const size_t neighborCell = m_grid.CellIndex(nx, ny);
+            for (uint32_t slot = m_grid.CellStart(neighborCell), end = slot + m_grid.CellCount(neighborCell); slot < end; slot++) {
+                const uint32_t j = sorted[slot];
+                // every pair is listed once, by its lower index. fixed pairs never move
+                if (j <= index || (fixed && m_cellFixed[slot])) {
+                    continue;
+                }
+                const float dx = m_cellX[slot] - x;
+                const float dy = m_cellY[slot] - y;
+                const float reach = radius + m_cellRadius[slot] + m_skin;
+                if (dx * dx + dy * dy < reach * reach) {
+                    visit(j);
+                }
+            }
+        }
+    }
+}
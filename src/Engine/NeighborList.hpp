@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.hpp"
+#include "UniformGrid.hpp"
+#include "utils/ThreadPool.hpp"
+
+/// Verlet neighbor lists in CSR layout.
+/// Every particle lists the higher indexed particles closer than the sum of both
+/// radii plus a skin distance, all lists packed back to back in `m_neighbors`.
+/// As long as no particle moved more than half the skin since the build, no pair
+/// can have come into contact without being listed, so the lists are reused
+/// across substeps and frames and only rebuilt when NeedsRebuild() says so.
+class NeighborList {
+public:
+    void Build(const ParticleStore& particles, float maxRadius, float skin, mt::ThreadPool& threadPool);
+
+    // true once any particle moved more than half the skin, or the particles changed
+    bool NeedsRebuild(const ParticleStore& particles, mt::ThreadPool& threadPool) const;
+
+    // forces a rebuild, needed when particle indices change
+    inline void Invalidate() {
+        m_valid = false;
+    }
+
+    inline uint32_t NeighborsStart(size_t index) const {
+        return m_neighborStart[index];
+    }
+
+    inline uint32_t NeighborsCount(size_t index) const {
+        return m_neighborStart[index + 1] - m_neighborStart[index];
+    }
+
+    inline const uint32_t* Neighbors() const {
+        return m_neighbors.data();
+    }
+
+    inline size_t PairsCount() const {
+        return m_neighbors.size();
+    }
+
+    inline uint64_t BuildsCount() const {
+        return m_buildsCount;
+    }
+
+private:
+    bool m_valid = false;
+    float m_skin = 0.0f;
+    uint64_t m_buildsCount = 0;
+    UniformGrid m_grid;
+    // positions at the last build, to measure displacement against
+    std::vector<float> m_builtX, m_builtY;
+    // particle data gathered in grid order, so a cell walk reads contiguous memory
+    std::vector<float> m_cellX, m_cellY, m_cellRadius;
+    std::vector<uint8_t> m_cellFixed;
+    std::vector<uint32_t> m_neighborStart;
+    std::vector<uint32_t> m_neighbors;
+
+    template <typename Visit>
+    void forEachNeighbor(const ParticleStore& particles, size_t index, Visit visit) const;
+};
@@ -2,78 +2,35 @@
 #include "Particle.hpp"
 #include <raymath.h>
 
-Particle::Particle(const Vector2& pos, float radius, const Color color, bool isFixed)
-    : m_position(pos)
-    , m_oldPosition(pos)
-    , m_acceleration(Vector2 { 0, 0 })
-    , m_radius(radius)
-    , m_color(color)
-    , m_isFixed(isFixed)
-    {}
-
-// move constructor for more performance when vector grows
-Particle::Particle(Particle&& particle) noexcept
-    : m_position(particle.m_position)
-    , m_oldPosition(particle.m_oldPosition)
-    , m_acceleration(particle.m_acceleration)
-    , m_radius(particle.m_radius)
-    , m_color(particle.m_color)
-    , m_isFixed(particle.m_isFixed)
-    {}
-
-Particle& Particle::operator=(Particle&& particle) noexcept {
-    if (this == &particle) {
-        // Prevent self-assignment
-        return *this;
-    }
-    m_position = particle.m_position;
-    m_oldPosition = particle.m_oldPosition;
-    m_acceleration = particle.m_acceleration;
-    m_radius = particle.m_radius;
-    m_color = particle.m_color;
-    m_isFixed = particle.m_isFixed;
-    return *this;
-}
-
 void Particle::Update(float dt) {
-    if (m_isFixed) {
+    if (IsStill()) {
         return;
     }
-    Vector2 velocity = Vector2Subtract(m_position, m_oldPosition);
-    m_oldPosition = m_position;
-    m_position.x += velocity.x + m_acceleration.x * dt * dt;
-    m_position.y += velocity.y + m_acceleration.y * dt * dt;
-    m_acceleration = Vector2 { 0, 0 }; // reset acceleration
+    ParticleStore& store = *m_store;
+    const size_t i = m_index;
+    Vector2 velocity = GetVelocity();
+    store.oldX[i] = store.x[i];
+    store.oldY[i] = store.y[i];
+    store.x[i] += velocity.x + store.ax[i] * dt * dt;
+    store.y[i] += velocity.y + store.ay[i] * dt * dt;
+    // reset acceleration
+    store.ax[i] = 0.0f;
+    store.ay[i] = 0.0f;
 }
 
 void Particle::ApplyForce(const Vector2& force) {
-    if (!IsFixed()) {
-        m_acceleration.x += force.x;
-        m_acceleration.y += force.y;
+    if (IsAsleep()) {
+        Wake();
     }
-}
-
-void Particle::Draw(const Texture2D* particleTexture) const {
-    if (particleTexture != nullptr && particleTexture->id > 0) {
-        float radius = GetRadius();
-        float diameter = radius * 2;
-        Rectangle source = Rectangle {
-            0, 0,
-            (float)particleTexture->width, (float)particleTexture->height
-        };
-        Rectangle dest = Rectangle {
-            m_position.x, m_position.y,
-            diameter, diameter
-        };
-        Vector2 origin = Vector2 { radius, radius };
-        DrawTexturePro(*particleTexture, source, dest, origin, 0.0f, m_color);
-    } else {
-        DrawCircle(m_position.x, m_position.y, m_radius, m_color);
+    if (!IsStill()) {
+        m_store->ax[m_index] += force.x;
+        m_store->ay[m_index] += force.y;
     }
 }
 
 bool Particle::CheckCollision(const Particle& first, const Particle& second) {
-    if (first.IsFixed() && second.IsFixed()) {
+    // a sleeping pile costs nothing but this check
+    if (first.IsStill() && second.IsStill()) {
         return false;
     }
     Vector2 delta = Vector2Subtract(first.GetPosition(), second.GetPosition());
@@ -96,25 +53,63 @@ void Particle::ResolveCollision(Particle& first, Particle& second) {
     float overlap = minPermissibleDistance - distance;
 
     if (overlap >= Particle::eps) {
+        // a sleeper is hit by something moving fast enough, it takes part again
+        wakeOnImpact(first, second);
+        wakeOnImpact(second, first);
+
         // normal direction per unit distance
         Vector2 collisionNormal = Vector2Scale(delta, 1.0f / distance);
         // position change will be half of the overlap if none is fixed
         Vector2 positionChange = Vector2Scale(
             collisionNormal,
-            first.IsFixed() || second.IsFixed() ? overlap : overlap * 0.5f
+            first.IsStill() || second.IsStill() ? overlap : overlap * 0.5f
         );
 
         // push particles apart
         // Apply a basic velocity dampening to avoid energy gain
-        if (!first.IsFixed()) {
-            first.m_position = Vector2Subtract(first.GetPosition(), positionChange);
+        if (!first.IsStill()) {
+            Vector2 position = Vector2Subtract(first.GetPosition(), positionChange);
+            first.m_store->x[first.m_index] = position.x;
+            first.m_store->y[first.m_index] = position.y;
             Vector2 velocity = first.GetVelocity();
             first.SetVelocity(Vector2Scale(velocity, Particle::dampening));
         }
-        if (!second.IsFixed()) {
-            second.m_position = Vector2Add(second.GetPosition(), positionChange);
+        if (!second.IsStill()) {
+            Vector2 position = Vector2Add(second.GetPosition(), positionChange);
+            second.m_store->x[second.m_index] = position.x;
+            second.m_store->y[second.m_index] = position.y;
             Vector2 velocity = second.GetVelocity();
             second.SetVelocity(Vector2Scale(velocity, Particle::dampening));
         }
     }
 }
+
+void Particle::ResolveStaticCollision(Particle& particle, const Vector2& position, float radius) {
+    Vector2 delta = Vector2Subtract(particle.GetPosition(), position);
+    float distance = Vector2Length(delta);
+    if (distance == 0.0f) {
+        // avoid divide by zero
+        return;
+    }
+    float overlap = particle.GetRadius() + radius - distance;
+    if (overlap >= Particle::eps) {
+        // the collider can't move, the particle takes the whole overlap
+        Vector2 collisionNormal = Vector2Scale(delta, 1.0f / distance);
+        Vector2 positionChange = Vector2Scale(collisionNormal, overlap);
+        Vector2 newPosition = Vector2Add(particle.GetPosition(), positionChange);
+        particle.m_store->x[particle.m_index] = newPosition.x;
+        particle.m_store->y[particle.m_index] = newPosition.y;
+        Vector2 velocity = particle.GetVelocity();
+        particle.SetVelocity(Vector2Scale(velocity, Particle::dampening));
+    }
+}
+
+void Particle::wakeOnImpact(Particle& sleeper, const Particle& other) {
+    if (!sleeper.IsAsleep() || other.IsStill()) {
+        return;
+    }
+    Vector2 velocity = other.GetVelocity();
+    if (velocity.x * velocity.x + velocity.y * velocity.y > wakeSpeed * wakeSpeed) {
+        sleeper.Wake();
+    }
+}
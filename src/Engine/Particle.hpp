@@ -1,28 +1,42 @@
 #pragma once
 
 #include <raylib.h>
+#include "ParticleStore.hpp"
 
+/// Lightweight view over one particle inside a ParticleStore.
+/// The particle data itself lives in the store's arrays, this only keeps
+/// the store and the index, so it is cheap to create and pass by value.
 class Particle {
 public:
     // a small epsilon value to account for floating-point imprecision.
     static constexpr float eps = 0.0001f;
     static constexpr float dampening = 0.98f;
+    // distance per step under which a particle counts as resting, and the speed an
+    // awake particle needs to wake a sleeping one it touches or sits next to
+    static constexpr float sleepSpeed = 0.001f;
+    static constexpr float wakeSpeed = 0.005f;
 
-    Particle(const Vector2& pos, float radius, const Color color = WHITE, bool isFixed = false);
-    Particle(Particle&& particle) noexcept;
-
-    Particle& operator=(Particle&& particle) noexcept;
+    Particle(ParticleStore& store, size_t index)
+        : m_store(&store)
+        , m_index(index)
+        {}
 
     void Update(float dt);
     void ApplyForce(const Vector2& force);
 
+    inline size_t GetIndex() const {
+        return m_index;
+    }
+
     inline Vector2 GetPosition() const {
-        return m_position;
+        return Vector2 { m_store->x[m_index], m_store->y[m_index] };
     }
 
     inline void SetPosition(const Vector2& pos) {
-        m_position = Vector2 { pos.x, pos.y };
-        m_oldPosition = Vector2 { pos.x, pos.y };
+        m_store->x[m_index] = pos.x;
+        m_store->y[m_index] = pos.y;
+        m_store->oldX[m_index] = pos.x;
+        m_store->oldY[m_index] = pos.y;
     }
 
     inline void SetPositionWithSameVelocity(const Vector2& pos) {
@@ -33,43 +47,71 @@ public:
 
     inline Vector2 GetVelocity() const {
         return Vector2 {
-            m_position.x - m_oldPosition.x,
-            m_position.y - m_oldPosition.y,
+            m_store->x[m_index] - m_store->oldX[m_index],
+            m_store->y[m_index] - m_store->oldY[m_index],
         };
     }
 
     inline void SetVelocity(const Vector2 &velocity) {
-        m_oldPosition.x = m_position.x - velocity.x;
-        m_oldPosition.y = m_position.y - velocity.y;
+        m_store->oldX[m_index] = m_store->x[m_index] - velocity.x;
+        m_store->oldY[m_index] = m_store->y[m_index] - velocity.y;
     }
 
     inline float GetRadius() const {
-        return m_radius;
+        return m_store->radius[m_index];
     }
 
     inline Color GetColor() const {
-        return m_color;
+        return m_store->color[m_index];
     }
 
     inline bool IsFixed() const {
-        return m_isFixed;
+        return (m_store->flags[m_index] & ParticleStore::fixedFlag) != 0;
     }
 
     inline void MakeFixed(bool fixed = true) {
-        m_isFixed = fixed;
+        if (fixed) {
+            m_store->flags[m_index] |= ParticleStore::fixedFlag;
+        } else {
+            m_store->flags[m_index] &= ~ParticleStore::fixedFlag;
+        }
+    }
+
+    inline bool IsAsleep() const {
+        return (m_store->flags[m_index] & ParticleStore::asleepFlag) != 0;
+    }
+
+    // fixed or asleep, either way it is not integrated and collisions don't move it
+    inline bool IsStill() const {
+        return m_store->flags[m_index] != 0;
+    }
+
+    inline void Sleep() {
+        m_store->flags[m_index] |= ParticleStore::asleepFlag;
+        // rests exactly where it is
+        m_store->oldX[m_index] = m_store->x[m_index];
+        m_store->oldY[m_index] = m_store->y[m_index];
+    }
+
+    inline void Wake() {
+        m_store->flags[m_index] &= ~ParticleStore::asleepFlag;
+        m_store->sleepSteps[m_index] = 0;
     }
 
     void Draw(const Texture2D* particleTexture = nullptr) const;
 
+    static void Draw(const Vector2& position, float radius, Color color, const Texture2D* particleTexture);
+
     static bool CheckCollision(const Particle& first, const Particle& second);
 
     static void ResolveCollision(Particle& first, Particle& second);
 
+    // same as ResolveCollision against a fixed particle that only exists as a position and radius
+    static void ResolveStaticCollision(Particle& particle, const Vector2& position, float radius);
+
 private:
-    Vector2 m_position;
-    Vector2 m_oldPosition;
-    Vector2 m_acceleration;
-    float m_radius;
-    Color m_color;
-    bool m_isFixed;
-};
\ No newline at end of file
+    static void wakeOnImpact(Particle& sleeper, const Particle& other);
+
+    ParticleStore* m_store;
+    size_t m_index;
+};
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include "ParticleRenderer.hpp"
+#include <raymath.h>
+#include <rlgl.h>
+
+void ParticleRenderer::Begin(size_t count) {
+    m_count = count;
+    if (m_vertices.size() < count * 4) {
+        m_vertices.resize(count * 4);
+    }
+}
+
+void ParticleRenderer::End(const Texture2D& texture) {
+    m_lastDrawCalls = 0;
+    if (m_count == 0) {
+        return;
+    }
+    if (m_count > m_capacity) {
+        // some headroom so a slowly growing scene doesn't reallocate every frame
+        load(std::max(m_count, m_capacity * 3 / 2));
+    }
+    // whatever raylib batched so far (obstacles, text) goes first
+    rlDrawRenderBatchActive();
+
+    const int* locs = rlGetShaderLocsDefault();
+    rlEnableShader(rlGetShaderIdDefault());
+    const Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    rlSetUniformMatrix(locs[RL_SHADER_LOC_MATRIX_MVP], mvp);
+    const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    rlSetUniform(locs[RL_SHADER_LOC_COLOR_DIFFUSE], white, RL_SHADER_UNIFORM_VEC4, 1);
+    const int textureSlot = 0;
+    rlSetUniform(locs[RL_SHADER_LOC_MAP_DIFFUSE], &textureSlot, RL_SHADER_UNIFORM_INT, 1);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(texture.id);
+
+    rlEnableVertexArray(m_vao);
+    rlEnableVertexBuffer(m_vbo);
+    // one upload for the whole frame
+    rlUpdateVertexBuffer(m_vbo, m_vertices.data(), (int)(m_count * 4 * sizeof(Vertex)), 0);
+    rlEnableVertexBufferElement(m_ebo);
+    const int stride = (int)sizeof(Vertex);
+    const unsigned int position = (unsigned int)locs[RL_SHADER_LOC_VERTEX_POSITION];
+    const unsigned int texcoord = (unsigned int)locs[RL_SHADER_LOC_VERTEX_TEXCOORD01];
+    const unsigned int color = (unsigned int)locs[RL_SHADER_LOC_VERTEX_COLOR];
+    rlEnableVertexAttribute(position);
+    rlEnableVertexAttribute(texcoord);
+    rlEnableVertexAttribute(color);
+    for (size_t first = 0; first < m_count; first += quadsPerDraw) {
+        // the indices only reach 16384 quads, so every draw starts its attributes at its first quad
+        const int base = (int)(first * 4 * sizeof(Vertex));
+        rlSetVertexAttribute(position, 2, RL_FLOAT, false, stride, base + (int)offsetof(Vertex, x));
+        rlSetVertexAttribute(texcoord, 2, RL_FLOAT, false, stride, base + (int)offsetof(Vertex, u));
+        rlSetVertexAttribute(color, 4, RL_UNSIGNED_BYTE, true, stride, base + (int)offsetof(Vertex, color));
+        const size_t quads = std::min(quadsPerDraw, m_count - first);
+        rlDrawVertexArrayElements(0, (int)(quads * 6), nullptr);
+        m_lastDrawCalls++;
+    }
+
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+    rlDisableVertexBufferElement();
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+void ParticleRenderer::load(size_t capacity) {
+    Unload();
+    m_capacity = capacity;
+    // a VAO is required by core profiles, older contexts go without (m_vao stays 0)
+    m_vao = rlLoadVertexArray();
+    rlEnableVertexArray(m_vao);
+    m_vbo = rlLoadVertexBuffer(nullptr, (int)(capacity * 4 * sizeof(Vertex)), true);
+
+    // the same two triangles for every quad, shared by all the draws
+    std::vector<unsigned short> indices(quadsPerDraw * 6);
+    for (size_t quad = 0; quad < quadsPerDraw; quad++) {
+        const unsigned short corner = (unsigned short)(quad * 4);
+        unsigned short* triangles = &indices[quad * 6];
+        triangles[0] = corner;
+        triangles[1] = corner + 1;
+        triangles[2] = corner + 2;
+        triangles[3] = corner;
+        triangles[4] = corner + 2;
+        triangles[5] = corner + 3;
+    }
+    m_ebo = rlLoadVertexBufferElement(indices.data(), (int)(indices.size() * sizeof(unsigned short)), false);
+    rlDisableVertexArray();
+}
+
+void ParticleRenderer::Unload() {
+    if (m_vbo != 0) {
+        rlUnloadVertexBuffer(m_vbo);
+        rlUnloadVertexBuffer(m_ebo);
+    }
+    if (m_vao != 0) {
+        rlUnloadVertexArray(m_vao);
+    }
+    m_vao = m_vbo = m_ebo = 0;
+    m_capacity = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <raylib.h>
+
+/// Draws many textured particle quads with a few draw calls, straight through rlgl.
+/// Quads are written into one preallocated vertex array on the render thread
+/// (VerletEngine::Draw fills it from a RenderState while the pool simulates the next
+/// frame), uploaded with a single buffer update and drawn with raylib's default shader,
+/// 16384 quads per call since rlgl draws with 16 bit indices. Only plain vertex and
+/// index buffers are used, nothing past OpenGL 3.3 / ES 2, and it runs on Mesa's
+/// llvmpipe with both the GL 3.3 core and the GL 2.1 rlgl backends.
+///
+/// The GL objects are created on first use and must be freed with Unload()
+/// while the window (and its GL context) still exists, the destructor doesn't.
+class ParticleRenderer {
+public:
+    static constexpr size_t quadsPerDraw = 16384;
+
+    ParticleRenderer() = default;
+    ~ParticleRenderer() = default;
+
+    ParticleRenderer(const ParticleRenderer&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+
+    // starts a frame of `count` quads, grows the vertex array when needed
+    void Begin(size_t count);
+
+    inline void SetQuad(size_t index, const Vector2& center, float radius, Color color) {
+        Vertex* quad = &m_vertices[index * 4];
+        const float left = center.x - radius, right = center.x + radius;
+        const float top = center.y - radius, bottom = center.y + radius;
+        quad[0] = Vertex { left, top, 0.0f, 0.0f, color };
+        quad[1] = Vertex { left, bottom, 0.0f, 1.0f, color };
+        quad[2] = Vertex { right, bottom, 1.0f, 1.0f, color };
+        quad[3] = Vertex { right, top, 1.0f, 0.0f, color };
+    }
+
+    // uploads the quads of this frame and draws them with `texture`
+    void End(const Texture2D& texture);
+
+    void Unload();
+
+    inline uint32_t LastDrawCalls() const {
+        return m_lastDrawCalls;
+    }
+
+private:
+    struct Vertex {
+        float x, y;
+        float u, v;
+        Color color;
+    };
+
+    void load(size_t capacity);
+
+    std::vector<Vertex> m_vertices;
+    size_t m_count = 0;
+    // quads the GPU buffer was created for
+    size_t m_capacity = 0;
+    uint32_t m_lastDrawCalls = 0;
+
+    unsigned int m_vao = 0;
+    unsigned int m_vbo = 0;
+    unsigned int m_ebo = 0;
+};
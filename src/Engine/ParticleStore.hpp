@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <raylib.h>
+
+/// Structure-of-arrays storage for every particle in the engine.
+/// Hot fields touched by integration/collision loops live in their own contiguous
+/// float arrays, so those loops stream only the data they need (and can be vectorized),
+/// while color and flags sit in cold arrays that are only read when drawing.
+struct ParticleStore {
+    // bits of `flags`, any set bit keeps the particle still
+    static constexpr uint8_t fixedFlag = 1 << 0;
+    static constexpr uint8_t asleepFlag = 1 << 1;
+
+    // hot data
+    std::vector<float> x, y;
+    std::vector<float> oldX, oldY;
+    std::vector<float> ax, ay;
+    std::vector<float> radius;
+
+    // cold data
+    std::vector<Color> color;
+    std::vector<uint8_t> flags;
+    // consecutive steps spent below the sleep speed
+    std::vector<uint16_t> sleepSteps;
+    // stable id of the particle in every slot, slots move when the engine reorders
+    std::vector<uint32_t> id;
+
+    inline size_t Size() const {
+        return x.size();
+    }
+
+    inline size_t Capacity() const {
+        return x.capacity();
+    }
+
+    void Reserve(size_t capacity) {
+        x.reserve(capacity);
+        y.reserve(capacity);
+        oldX.reserve(capacity);
+        oldY.reserve(capacity);
+        ax.reserve(capacity);
+        ay.reserve(capacity);
+        radius.reserve(capacity);
+        color.reserve(capacity);
+        flags.reserve(capacity);
+        sleepSteps.reserve(capacity);
+        id.reserve(capacity);
+    }
+
+    void Clear() {
+        x.clear();
+        y.clear();
+        oldX.clear();
+        oldY.clear();
+        ax.clear();
+        ay.clear();
+        radius.clear();
+        color.clear();
+        flags.clear();
+        sleepSteps.clear();
+        id.clear();
+    }
+
+    size_t Add(const Vector2& position, float particleRadius, Color particleColor) {
+        x.push_back(position.x);
+        y.push_back(position.y);
+        oldX.push_back(position.x);
+        oldY.push_back(position.y);
+        ax.push_back(0.0f);
+        ay.push_back(0.0f);
+        radius.push_back(particleRadius);
+        color.push_back(particleColor);
+        flags.push_back(0);
+        sleepSteps.push_back(0);
+        id.push_back((uint32_t)id.size());
+        return x.size() - 1;
+    }
+};
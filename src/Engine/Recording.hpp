@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// Stream format shared by FrameRecorder and FramePlayer.
+/// A file header, then one record per frame: a FrameHeader and an lz block that
+/// expands to `rawBytes`. Positions are 16 bit fixed point over the world bounds and
+/// stored as differences to the previous frame, split in byte planes so resting
+/// particles become long runs of zeros:
+///     dx low bytes [n], dx high bytes [n], dy low bytes [n], dy high bytes [n]
+///     radius (float) and color of the particles from firstNewParticle on
+///     x, y, radius (floats) and color of the static colliders from firstNewStatic on
+/// Particles are stored in id order, so engine reorders don't show up as movement.
+/// Everything is little-endian.
+
+namespace recording {
+
+constexpr char magic[8] = { 'V', 'E', 'R', 'L', 'E', 'T', 'R', 'C' };
+constexpr uint32_t version = 1;
+
+// the frame starts over: the player drops what it has and every particle is new
+constexpr uint32_t keyFrameFlag = 1 << 0;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    float worldWidth;
+    float worldHeight;
+};
+
+struct FrameHeader {
+    uint32_t flags;
+    uint32_t particlesCount;
+    // particles (and static colliders) below these were in the previous frame already
+    uint32_t firstNewParticle;
+    uint32_t staticCount;
+    uint32_t firstNewStatic;
+    uint32_t rawBytes;
+    uint32_t compressedBytes;
+};
+
+// bytes a frame expands to
+inline uint64_t RawFrameBytes(const FrameHeader& frame) {
+    return (uint64_t)frame.particlesCount * 4
+        + (uint64_t)(frame.particlesCount - frame.firstNewParticle) * 8
+        + (uint64_t)(frame.staticCount - frame.firstNewStatic) * 16;
+}
+
+// 16 bit fixed point over [0, extent], about 0.01 px on an 800 px wide world
+inline uint16_t Quantize(float value, float extent) {
+    const float normalized = std::min(std::max(value / extent, 0.0f), 1.0f);
+    return (uint16_t)std::lround(normalized * 65535.0f);
+}
+
+inline float Dequantize(uint16_t value, float extent) {
+    return value / 65535.0f * extent;
+}
+
+} // namespace recording
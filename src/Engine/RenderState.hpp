@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <raylib.h>
+
+/// What VerletEngine::Draw needs of one simulated frame, copied out of the engine
+/// by PublishRenderState so it can be drawn while the solver works on the next one.
+struct RenderState {
+    // already interpolated between the last two steps
+    std::vector<float> x, y, radius;
+    std::vector<Color> color;
+    std::vector<float> staticX, staticY, staticRadius;
+    std::vector<Color> staticColor;
+    size_t asleepCount = 0;
+
+    inline size_t ParticlesCount() const {
+        return x.size();
+    }
+
+    inline size_t StaticCollidersCount() const {
+        return staticX.size();
+    }
+};
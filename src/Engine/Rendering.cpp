@@ -0,0 +1,87 @@
+#include "Particle.hpp"
+#include "ParticleRenderer.hpp"
+#include "VerletEngine.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
+
+/// Everything that talks to raylib's renderer lives here, so headless
+/// targets can build the engine without linking raylib at all.
+
+void Particle::Draw(const Texture2D* particleTexture) const {
+    Draw(GetPosition(), GetRadius(), GetColor(), particleTexture);
+}
+
+void Particle::Draw(const Vector2& position, float radius, Color color, const Texture2D* particleTexture) {
+    if (particleTexture != nullptr && particleTexture->id > 0) {
+        float diameter = radius * 2;
+        Rectangle source = Rectangle {
+            0, 0,
+            (float)particleTexture->width, (float)particleTexture->height
+        };
+        Rectangle dest = Rectangle {
+            position.x, position.y,
+            diameter, diameter
+        };
+        Vector2 origin = Vector2 { radius, radius };
+        DrawTexturePro(*particleTexture, source, dest, origin, 0.0f, color);
+    } else {
+        DrawCircle(position.x, position.y, radius, color);
+    }
+}
+
+void VerletEngine::Draw(const RenderState& state, const Texture2D* particleTexture, ParticleRenderer* renderer) const {
+    PROFILE_SCOPE(prof::Phase::EngineDraw);
+    // obstacles are drawn exactly as the particles see them, one square per solid node.
+    // the solver only reads them, so they don't need a copy in the render state
+    const float cellSize = m_obstacles.CellSize();
+    for (int32_t row = 0; !m_obstacles.IsEmpty() && row < m_obstacles.Rows(); row++) {
+        for (int32_t column = 0; column < m_obstacles.Columns(); column++) {
+            if (m_obstacles.NodeDistance(column, row) <= 0.0f) {
+                DrawRectangleV(
+                    Vector2 { (column - 0.5f) * cellSize, (row - 0.5f) * cellSize },
+                    Vector2 { cellSize, cellSize },
+                    DARKGRAY
+                );
+            }
+        }
+    }
+    const size_t staticCount = state.StaticCollidersCount();
+    const size_t count = state.ParticlesCount();
+    const bool batched = renderer != nullptr
+        && particleTexture != nullptr && particleTexture->id > 0
+        && FeatureFlags::Instance().IsEnabled(Feature::BatchedRendering);
+    if (batched) {
+        // statics first, then particles, the same order as the immediate path below.
+        // filled on this thread, the pool may be busy with the next frame
+        renderer->Begin(staticCount + count);
+        for (size_t i = 0; i < staticCount; i++) {
+            renderer->SetQuad(
+                i,
+                Vector2 { state.staticX[i], state.staticY[i] },
+                state.staticRadius[i],
+                state.staticColor[i]
+            );
+        }
+        for (size_t i = 0; i < count; i++) {
+            renderer->SetQuad(staticCount + i, Vector2 { state.x[i], state.y[i] }, state.radius[i], state.color[i]);
+        }
+        renderer->End(*particleTexture);
+        return;
+    }
+    for (size_t i = 0; i < staticCount; i++) {
+        Particle::Draw(
+            Vector2 { state.staticX[i], state.staticY[i] },
+            state.staticRadius[i],
+            state.staticColor[i],
+            particleTexture
+        );
+    }
+    for (size_t i = 0; i < count; i++) {
+        Particle::Draw(
+            Vector2 { state.x[i], state.y[i] },
+            state.radius[i],
+            state.color[i],
+            particleTexture
+        );
+    }
+}
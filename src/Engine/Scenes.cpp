@@ -0,0 +1,87 @@
+#include <assert.h>
+#include <cmath>
+#include <cstdlib>
+#include "Scenes.hpp"
+
+namespace Scenes {
+
+void SpawnFixedParticles(
+    VerletEngine& engine,
+    const std::initializer_list<Vector2>& positions,
+    float particleRadius
+) {
+    // optional: it prevents frequent resize
+    engine.EnsureCapacity(positions.size());
+    for (const Vector2& position : positions) {
+        engine.AddFixedParticle(position, particleRadius, GRAY);
+    }
+}
+
+void SpawnParticles(
+    VerletEngine& engine,
+    uint32_t width,
+    uint32_t height,
+    float probability,
+    uint32_t limit,
+    float particleRadius
+) {
+    assert(probability <= 1.0f);
+    const float particleDiameter = particleRadius * 2;
+    const uint32_t rows = (uint32_t)round(height / particleDiameter);
+    const uint32_t columns = (uint32_t)round(width / particleDiameter);
+    const bool shouldCalculateChances = probability < 1.0f;
+    uint32_t actualLimit = std::min(limit, rows * columns);
+    engine.EnsureCapacity(actualLimit); // optional: it prevents frequent resize
+    /// ideally the column loop should be above and rows should be nested
+    /// BUT, I need to stop(break) particle creation if limit is reached and I want it to fill
+    /// in the order of top to bottom rather than left to right
+    for (uint32_t row = 0; row < rows && actualLimit > 0; row += 1) {
+        for (uint32_t col = 0; col < columns && actualLimit > 0; col += 1) {
+            if (shouldCalculateChances) {
+                float chance = (double)rand() / RAND_MAX;
+                // continue if chance of spawning lies outside permisible probability
+                if (chance > probability) {
+                    continue;
+                }
+            }
+            actualLimit -= 1;
+            Vector2 generatedPosition = Vector2 {
+                (float)(col * particleDiameter) + particleRadius,
+                (float)(row * particleDiameter) + particleRadius
+            };
+            engine.AddParticle(
+                generatedPosition,
+                particleRadius,
+                RED
+            );
+        }
+    }
+}
+
+void AddFunnelObstacles(VerletEngine& engine, uint32_t width, uint32_t height) {
+    const float w = (float)width, h = (float)height;
+    const float thickness = h / 60.0f;
+    SignedDistanceField obstacles;
+    obstacles.AddSegment(Vector2 { w * 0.1f, h * 0.45f }, Vector2 { w * 0.45f, h * 0.65f }, thickness);
+    obstacles.AddSegment(Vector2 { w * 0.9f, h * 0.45f }, Vector2 { w * 0.55f, h * 0.65f }, thickness);
+    obstacles.AddCircle(Vector2 { w * 0.5f, h * 0.82f }, h / 20.0f);
+    // a cell per particle diameter is enough for a smooth push
+    obstacles.Build(w, h, Constants::PARTICLE_RADIUS * 2.0f);
+    engine.SetObstacles(std::move(obstacles));
+}
+
+void SpawnDefault(VerletEngine& engine, uint32_t width, uint32_t height) {
+    SpawnFixedParticles(engine, {
+        Vector2 { (float)width / 4.0f, (float)height / 2.0f },
+        Vector2 { (float)width * 3.0f / 4.0f, (float)height / 2.0f }
+    });
+    SpawnParticles(
+        engine,
+        width,
+        height,
+        Constants::SPAWN_PROBABLITY,
+        Constants::SPAWN_LIMIT
+    );
+}
+
+} // namespace Scenes
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <climits>
+#include <initializer_list>
+#include "Constants.hpp"
+#include "VerletEngine.hpp"
+
+/// Scene setup shared by the windowed game and the headless runners.
+namespace Scenes {
+    void SpawnFixedParticles(
+        VerletEngine& engine,
+        const std::initializer_list<Vector2>& positions,
+        float particleRadius = Constants::PARTICLE_RADIUS
+    );
+
+    // fills the area top to bottom with particles, each cell spawns with `probability`
+    void SpawnParticles(
+        VerletEngine& engine,
+        uint32_t width,
+        uint32_t height,
+        float probability = 1.0,
+        uint32_t limit = UINT_MAX,
+        float particleRadius = Constants::PARTICLE_RADIUS
+    );
+
+    // a funnel and a round bumper under it as signed distance field obstacles
+    void AddFunnelObstacles(VerletEngine& engine, uint32_t width, uint32_t height);
+
+    // the scene main.cpp starts with: two fixed particles and a random fill
+    void SpawnDefault(VerletEngine& engine, uint32_t width, uint32_t height);
+}
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "SignedDistanceField.hpp"
+
+namespace {
+
+// squared euclidean distance transform of one line (Felzenszwalb & Huttenlocher),
+// `v` and `z` are scratch buffers of n and n + 1 entries
+void distanceTransform1D(const float* f, float* d, int32_t* v, float* z, int32_t n) {
+    int32_t k = 0;
+    v[0] = 0;
+    z[0] = -FLT_MAX;
+    z[1] = FLT_MAX;
+    for (int32_t q = 1; q < n; q++) {
+        // where the parabola of q starts to beat the lowest one so far
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FLT_MAX;
+    }
+    k = 0;
+    for (int32_t q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+// distance in nodes from every node to the closest node where `feature` is set
+void distanceTransform2D(const std::vector<uint8_t>& feature, int32_t columns, int32_t rows, std::vector<float>& out) {
+    // large but finite, infinities would turn into NaN in the parabola intersections
+    const float far = (float)(columns + rows) * (columns + rows);
+    const int32_t longest = std::max(columns, rows);
+    std::vector<float> f(longest), d(longest), z(longest + 1);
+    std::vector<int32_t> v(longest);
+
+    out.resize(feature.size());
+    for (size_t i = 0; i < feature.size(); i++) {
+        out[i] = feature[i] ? 0.0f : far;
+    }
+    for (int32_t column = 0; column < columns; column++) {
+        for (int32_t row = 0; row < rows; row++) {
+            f[row] = out[(size_t)row * columns + column];
+        }
+        distanceTransform1D(f.data(), d.data(), v.data(), z.data(), rows);
+        for (int32_t row = 0; row < rows; row++) {
+            out[(size_t)row * columns + column] = d[row];
+        }
+    }
+    for (int32_t row = 0; row < rows; row++) {
+        float* line = &out[(size_t)row * columns];
+        std::copy(line, line + columns, f.begin());
+        distanceTransform1D(f.data(), line, v.data(), z.data(), columns);
+    }
+    for (float& value : out) {
+        value = std::sqrt(value);
+    }
+}
+
+} // namespace
+
+void SignedDistanceField::AddSegment(const Vector2& a, const Vector2& b, float thickness) {
+    m_shapes.push_back(Shape { ShapeType::Segment, a, b, thickness * 0.5f });
+}
+
+void SignedDistanceField::AddBox(const Vector2& center, const Vector2& halfSize) {
+    m_shapes.push_back(Shape { ShapeType::Box, center, halfSize, 0.0f });
+}
+
+void SignedDistanceField::AddCircle(const Vector2& center, float radius) {
+    m_shapes.push_back(Shape { ShapeType::Circle, center, center, radius });
+}
+
+void SignedDistanceField::AddImage(const Image& image, const Rectangle& area, uint8_t threshold) {
+    int32_t bytesPerPixel;
+    int32_t solidChannel;
+    switch (image.format) {
+        case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE:  bytesPerPixel = 1; solidChannel = 0; break;
+        case PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA: bytesPerPixel = 2; solidChannel = 1; break;
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8A8:   bytesPerPixel = 4; solidChannel = 3; break;
+        default: return;
+    }
+    if (image.data == nullptr || image.width <= 0 || image.height <= 0) {
+        return;
+    }
+    Mask mask { {}, image.width, image.height, area };
+    mask.solid.resize((size_t)image.width * image.height);
+    const uint8_t* pixels = static_cast<const uint8_t*>(image.data);
+    for (size_t i = 0; i < mask.solid.size(); i++) {
+        mask.solid[i] = pixels[i * bytesPerPixel + solidChannel] >= threshold ? 1 : 0;
+    }
+    m_masks.push_back(std::move(mask));
+}
+
+float SignedDistanceField::shapeDistance(const Shape& shape, float x, float y) {
+    switch (shape.type) {
+        case ShapeType::Segment: {
+            const float abX = shape.b.x - shape.a.x, abY = shape.b.y - shape.a.y;
+            const float apX = x - shape.a.x, apY = y - shape.a.y;
+            const float lengthSquared = abX * abX + abY * abY;
+            const float t = lengthSquared > 0.0f
+                ? std::clamp((apX * abX + apY * abY) / lengthSquared, 0.0f, 1.0f)
+                : 0.0f;
+            const float dx = apX - abX * t, dy = apY - abY * t;
+            return std::sqrt(dx * dx + dy * dy) - shape.size;
+        }
+        case ShapeType::Box: {
+            const float qx = std::fabs(x - shape.a.x) - shape.b.x;
+            const float qy = std::fabs(y - shape.a.y) - shape.b.y;
+            const float outsideX = std::max(qx, 0.0f), outsideY = std::max(qy, 0.0f);
+            return std::sqrt(outsideX * outsideX + outsideY * outsideY) + std::min(std::max(qx, qy), 0.0f);
+        }
+        case ShapeType::Circle: {
+            const float dx = x - shape.a.x, dy = y - shape.a.y;
+            return std::sqrt(dx * dx + dy * dy) - shape.size;
+        }
+    }
+    return FLT_MAX;
+}
+
+void SignedDistanceField::Build(float width, float height, float cellSize) {
+    m_cellSize = cellSize;
+    m_distances.clear();
+    if (m_shapes.empty() && m_masks.empty()) {
+        m_columns = m_rows = 0;
+        return;
+    }
+    m_columns = (int32_t)std::ceil(width / cellSize) + 1;
+    m_rows = (int32_t)std::ceil(height / cellSize) + 1;
+    m_distances.assign((size_t)m_columns * m_rows, FLT_MAX);
+
+    // shapes have exact distances, the union is their minimum
+    for (int32_t row = 0; row < m_rows; row++) {
+        for (int32_t column = 0; column < m_columns; column++) {
+            float& distance = m_distances[(size_t)row * m_columns + column];
+            for (const Shape& shape : m_shapes) {
+                distance = std::min(distance, shapeDistance(shape, column * cellSize, row * cellSize));
+            }
+        }
+    }
+    addMaskDistances();
+}
+
+void SignedDistanceField::addMaskDistances() {
+    if (m_masks.empty()) {
+        return;
+    }
+    // rasterize all masks onto the nodes, then measure distances to solid nodes
+    // from the outside and to free nodes from the inside
+    std::vector<uint8_t> solid((size_t)m_columns * m_rows, 0);
+    for (const Mask& mask : m_masks) {
+        for (int32_t row = 0; row < m_rows; row++) {
+            for (int32_t column = 0; column < m_columns; column++) {
+                const float u = (column * m_cellSize - mask.area.x) / mask.area.width;
+                const float v = (row * m_cellSize - mask.area.y) / mask.area.height;
+                if (u < 0.0f || v < 0.0f || u >= 1.0f || v >= 1.0f) {
+                    continue;
+                }
+                const int32_t px = (int32_t)(u * mask.width);
+                const int32_t py = (int32_t)(v * mask.height);
+                if (mask.solid[(size_t)py * mask.width + px]) {
+                    solid[(size_t)row * m_columns + column] = 1;
+                }
+            }
+        }
+    }
+
+    std::vector<float> outside, inside;
+    distanceTransform2D(solid, m_columns, m_rows, outside);
+    for (uint8_t& node : solid) {
+        node = !node;
+    }
+    distanceTransform2D(solid, m_columns, m_rows, inside);
+    for (size_t i = 0; i < m_distances.size(); i++) {
+        // half a cell puts the surface between the last solid and the first free node
+        const float maskDistance = outside[i] > 0.0f
+            ? (outside[i] - 0.5f) * m_cellSize
+            : -(inside[i] - 0.5f) * m_cellSize;
+        m_distances[i] = std::min(m_distances[i], maskDistance);
+    }
+}
+
+float SignedDistanceField::Sample(float x, float y) const {
+    const float fx = std::clamp(x / m_cellSize, 0.0f, (float)(m_columns - 1));
+    const float fy = std::clamp(y / m_cellSize, 0.0f, (float)(m_rows - 1));
+    const int32_t x0 = std::min((int32_t)fx, m_columns - 2);
+    const int32_t y0 = std::min((int32_t)fy, m_rows - 2);
+    const float tx = fx - x0, ty = fy - y0;
+    const float* top = &m_distances[(size_t)y0 * m_columns + x0];
+    const float* bottom = top + m_columns;
+    const float upper = top[0] + (top[1] - top[0]) * tx;
+    const float lower = bottom[0] + (bottom[1] - bottom[0]) * tx;
+    return upper + (lower - upper) * ty;
+}
+
+bool SignedDistanceField::PushOut(Vector2& position, float radius) const {
+    const float distance = Sample(position.x, position.y);
+    if (distance >= radius) {
+        return false;
+    }
+    // central differences over half a cell give the outward direction
+    const float h = m_cellSize * 0.5f;
+    const float gradientX = Sample(position.x + h, position.y) - Sample(position.x - h, position.y);
+    const float gradientY = Sample(position.x, position.y + h) - Sample(position.x, position.y - h);
+    const float length = std::sqrt(gradientX * gradientX + gradientY * gradientY);
+    if (length == 0.0f) {
+        // flat spot deep inside, nowhere to go
+        return false;
+    }
+    const float push = (radius - distance) / length;
+    position.x += gradientX * push;
+    position.y += gradientY * push;
+    return true;
+}
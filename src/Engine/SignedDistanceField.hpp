@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <raylib.h>
+
+/// Static obstacles baked into a 2D signed distance grid.
+/// Shapes (segments, boxes, circles, image masks) are only collected by the Add
+/// calls, Build() then stores the distance to the closest obstacle surface at
+/// every grid node, negative inside. A particle is pushed out with one bilinear
+/// lookup and a gradient, no matter how many shapes there are.
+class SignedDistanceField {
+public:
+    // capsule of `thickness` around the segment a -> b
+    void AddSegment(const Vector2& a, const Vector2& b, float thickness);
+    void AddBox(const Vector2& center, const Vector2& halfSize);
+    void AddCircle(const Vector2& center, float radius);
+    // pixels with alpha (or gray level) of at least `threshold` are solid, the image
+    // is stretched over `area`. needs an uncompressed 8 bit format, RGBA or gray
+    void AddImage(const Image& image, const Rectangle& area, uint8_t threshold = 128);
+
+    // bakes every shape added so far into a grid covering [0, width] x [0, height]
+    void Build(float width, float height, float cellSize);
+
+    inline bool IsEmpty() const {
+        return m_distances.empty();
+    }
+
+    inline int32_t Columns() const {
+        return m_columns;
+    }
+
+    inline int32_t Rows() const {
+        return m_rows;
+    }
+
+    inline float CellSize() const {
+        return m_cellSize;
+    }
+
+    inline float NodeDistance(int32_t column, int32_t row) const {
+        return m_distances[(size_t)row * m_columns + column];
+    }
+
+    // bilinear distance at any point, clamped to the grid
+    float Sample(float x, float y) const;
+
+    // moves a circle out of the obstacles along the distance gradient,
+    // returns false when it was not touching any
+    bool PushOut(Vector2& position, float radius) const;
+
+private:
+    enum class ShapeType : uint8_t {
+        Segment,
+        Box,
+        Circle
+    };
+
+    struct Shape {
+        ShapeType type;
+        Vector2 a, b;
+        float size;
+    };
+
+    struct Mask {
+        std::vector<uint8_t> solid;
+        int32_t width, height;
+        Rectangle area;
+    };
+
+    std::vector<Shape> m_shapes;
+    std::vector<Mask> m_masks;
+
+    int32_t m_columns = 0, m_rows = 0;
+    float m_cellSize = 1.0f;
+    std::vector<float> m_distances;
+
+    static float shapeDistance(const Shape& shape, float x, float y);
+    void addMaskDistances();
+};
@@ -0,0 +1,56 @@
+#include <cmath>
+#include "Simulation.hpp"
+#include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
+
+Simulation::Simulation(
+    VerletEngine& engine,
+    uint32_t worldWidth,
+    uint32_t worldHeight,
+    float fixedDt,
+    uint32_t maxStepsPerFrame
+)
+    : m_engine(engine)
+    , m_worldWidth(worldWidth)
+    , m_worldHeight(worldHeight)
+    , m_fixedDt(fixedDt)
+    , m_maxStepsPerFrame(maxStepsPerFrame)
+    {}
+
+void Simulation::Advance(float frameDt) {
+    PROFILE_SCOPE(prof::Phase::Simulation);
+    m_accumulator += frameDt;
+    uint32_t steps = (uint32_t)std::floor(m_accumulator / m_fixedDt);
+    if (steps > m_maxStepsPerFrame) {
+        // can't keep up, drop the extra time instead of falling further behind
+        steps = m_maxStepsPerFrame;
+        m_accumulator = std::fmod(m_accumulator, (double)m_fixedDt) + steps * (double)m_fixedDt;
+        m_droppedFrames++;
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+        if (i + 1 == steps) {
+            // render interpolates between the last two steps of the frame
+            m_engine.SaveRenderPositions();
+        }
+        Step();
+        m_accumulator -= m_fixedDt;
+    }
+    m_lastFrameSteps = steps;
+}
+
+void Simulation::Step() {
+    bool motionEnabled = FeatureFlags::Instance().IsEnabled(Feature::Motion);
+    bool gravityEnabled = motionEnabled && FeatureFlags::Instance().IsEnabled(Feature::Gravity);
+    if (motionEnabled) {
+        // gravity and wind are fused into the integration + bounds pass
+        Vector2 acceleration = Constants::WIND_FORCE;
+        if (gravityEnabled) {
+            acceleration.x += Constants::GRAVITY.x;
+            acceleration.y += Constants::GRAVITY.y;
+        }
+        m_engine.Step(m_fixedDt, acceleration, m_worldWidth, m_worldHeight);
+    } else {
+        m_engine.ApplyConstraints(m_worldWidth, m_worldHeight);
+    }
+    m_engine.ResolveCollisions();
+}
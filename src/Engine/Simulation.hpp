@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include "Constants.hpp"
+#include "VerletEngine.hpp"
+
+/// Advances a VerletEngine with a fixed-timestep clock. Frame time goes into an
+/// accumulator that is drained in fixed steps, each step integrates, applies the
+/// world bounds and resolves collisions once. Steps per frame are capped so a
+/// hitch can't snowball into ever longer frames (spiral of death), and the leftover
+/// fraction of a step is exposed to interpolate render positions.
+/// Used by Game and by the headless runners, so both step the world the same way.
+class Simulation {
+public:
+    static constexpr uint32_t updateSubsteps = 4u;
+    static constexpr float defaultFixedDt = 1.0f / (Constants::PREFERRED_FPS * updateSubsteps);
+    static constexpr uint32_t defaultMaxStepsPerFrame = updateSubsteps * 4;
+
+    Simulation(
+        VerletEngine& engine,
+        uint32_t worldWidth,
+        uint32_t worldHeight,
+        float fixedDt = defaultFixedDt,
+        uint32_t maxStepsPerFrame = defaultMaxStepsPerFrame
+    );
+
+    // adds `frameDt` of real time and runs as many fixed steps as it covers
+    void Advance(float frameDt);
+
+    // one fixed step, without touching the accumulator
+    void Step();
+
+    inline float GetFixedDt() const {
+        return m_fixedDt;
+    }
+
+    // how far (0..1) real time is between the last two steps, for render interpolation
+    inline float GetInterpolation() const {
+        return (float)(m_accumulator / m_fixedDt);
+    }
+
+    inline uint32_t GetLastFrameSteps() const {
+        return m_lastFrameSteps;
+    }
+
+    // frames that hit maxStepsPerFrame and dropped simulation time
+    inline uint64_t GetDroppedFrames() const {
+        return m_droppedFrames;
+    }
+
+private:
+    VerletEngine& m_engine;
+    const uint32_t m_worldWidth, m_worldHeight;
+    const float m_fixedDt;
+    const uint32_t m_maxStepsPerFrame;
+    double m_accumulator = 0.0;
+    uint32_t m_lastFrameSteps = 0;
+    uint64_t m_droppedFrames = 0;
+};
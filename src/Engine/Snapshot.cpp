@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "Snapshot.hpp"
+
+namespace snapshot {
+
+// the header is part of the format, it must not change by accident
+static_assert(sizeof(Header) == 272, "snapshot header layout changed, bump the version");
+
+// bytes per element of every field, in Field order
+static constexpr uint64_t elementBytes[(size_t)Field::Count] = {
+    4, 4, 4, 4, 4, // x, y, oldX, oldY, radius
+    4, 1, 2, 4,    // color, flags, sleep steps, id
+    4, 4, 4, 4,    // static x, y, radius, color
+};
+
+static inline bool isStaticField(Field field) {
+    return field >= Field::StaticX;
+}
+
+// arrays are stored as they are in memory, only little-endian hosts can do that
+static inline bool isLittleEndian() {
+    const uint16_t probe = 1;
+    unsigned char firstByte;
+    memcpy(&firstByte, &probe, 1);
+    return firstByte == 1;
+}
+
+static inline uint64_t alignUp(uint64_t value) {
+    return (value + fieldAlignment - 1) / fieldAlignment * fieldAlignment;
+}
+
+bool Write(const char* path, Header header, const FieldData (&fields)[(size_t)Field::Count]) {
+    if (!isLittleEndian()) {
+        return false;
+    }
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.headerBytes = sizeof(Header);
+
+    static const unsigned char padding[fieldAlignment] = {};
+    std::vector<iovec> chunks;
+    chunks.reserve((size_t)Field::Count * 2 + 1);
+    chunks.push_back(iovec { &header, sizeof(Header) });
+    uint64_t offset = sizeof(Header);
+    for (size_t field = 0; field < (size_t)Field::Count; field++) {
+        const uint64_t start = alignUp(offset);
+        if (start > offset) {
+            chunks.push_back(iovec { (void*)padding, (size_t)(start - offset) });
+        }
+        header.fields[field] = FieldEntry { start, fields[field].bytes };
+        if (fields[field].bytes > 0) {
+            chunks.push_back(iovec { (void*)fields[field].data, (size_t)fields[field].bytes });
+        }
+        offset = start + fields[field].bytes;
+    }
+
+    // written next to the target and renamed over it, a crash never leaves half a checkpoint
+    const std::string tempPath = std::string(path) + ".tmp";
+    const int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // one call for the whole file, only repeated if the kernel takes less than everything
+    size_t first = 0;
+    bool written = true;
+    while (first < chunks.size()) {
+        ssize_t count = writev(fd, chunks.data() + first, (int)(chunks.size() - first));
+        if (count < 0) {
+            written = false;
+            break;
+        }
+        while (first < chunks.size() && (size_t)count >= chunks[first].iov_len) {
+            count -= chunks[first].iov_len;
+            first++;
+        }
+        if (first < chunks.size()) {
+            chunks[first].iov_base = static_cast<unsigned char*>(chunks[first].iov_base) + count;
+            chunks[first].iov_len -= count;
+        }
+    }
+    written = close(fd) == 0 && written;
+    if (!written || rename(tempPath.c_str(), path) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::Open(const char* path) {
+    close();
+    if (!isLittleEndian()) {
+        return false;
+    }
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+    m_size = (size_t)info.st_size;
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        return false;
+    }
+    m_data = data;
+
+    const Header& header = GetHeader();
+    bool valid = memcmp(header.magic, magic, sizeof(magic)) == 0
+        && header.version == version
+        && header.headerBytes == sizeof(Header);
+    for (size_t field = 0; valid && field < (size_t)Field::Count; field++) {
+        const FieldEntry& entry = header.fields[field];
+        const uint64_t count = isStaticField((Field)field) ? header.staticCount : header.particlesCount;
+        // count is checked before multiplying, a huge one would wrap around to a small size
+        valid = entry.offset % fieldAlignment == 0
+            && count <= m_size / elementBytes[field]
+            && entry.bytes == count * elementBytes[field]
+            && entry.offset <= m_size
+            && entry.bytes <= m_size - entry.offset;
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+} // namespace snapshot
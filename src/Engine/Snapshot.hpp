@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Binary snapshot of the engine state, for checkpointing long runs.
+/// Layout (little-endian): a fixed size header, then one contiguous array per
+/// field, each starting on a 64 byte boundary. The header records where every
+/// array starts and how many bytes it holds, so a reader never parses anything,
+/// it maps the file and points into it.
+/// Files are written in one writev() call straight from the engine arrays.
+namespace snapshot {
+
+constexpr char magic[8] = { 'V', 'E', 'R', 'L', 'E', 'T', 'S', 'S' };
+// bump whenever the header or the field list changes, older files are refused
+constexpr uint32_t version = 1;
+constexpr uint64_t fieldAlignment = 64;
+
+// arrays in file order, appended fields go before Count
+enum class Field : uint32_t {
+    X,
+    Y,
+    OldX,
+    OldY,
+    Radius,
+    Color,
+    Flags,
+    SleepSteps,
+    Id,
+    StaticX,
+    StaticY,
+    StaticRadius,
+    StaticColor,
+    Count
+};
+
+struct FieldEntry {
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t particlesCount;
+    uint64_t staticCount;
+
+    // solver state, so a resumed run continues exactly where the saved one was
+    uint64_t seed;
+    uint64_t collisionPasses;
+    uint32_t passesSinceReorder;
+    uint32_t iterateForward;
+    float lastAccelerationX;
+    float lastAccelerationY;
+
+    FieldEntry fields[(size_t)Field::Count];
+};
+
+// one array to write, `data` may be null when `bytes` is 0
+struct FieldData {
+    const void* data;
+    uint64_t bytes;
+};
+
+// fills in the header's magic, version and field table, then writes the header and
+// every array with a single writev. returns false if anything can't be written
+bool Write(const char* path, Header header, const FieldData (&fields)[(size_t)Field::Count]);
+
+// read only mapping of a snapshot file, unmapped when it goes out of scope
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps the file and checks the header and the field table against its size
+    bool Open(const char* path);
+
+    inline const Header& GetHeader() const {
+        return *static_cast<const Header*>(m_data);
+    }
+
+    // the array of `field` inside the mapping, valid while the file is open
+    template <typename T>
+    inline const T* Get(Field field) const {
+        return reinterpret_cast<const T*>(
+            static_cast<const unsigned char*>(m_data) + GetHeader().fields[(size_t)field].offset
+        );
+    }
+
+private:
+    void close();
+
+    void* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace snapshot
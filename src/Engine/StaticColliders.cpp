@@ -0,0 +1,65 @@
+#include <algorithm>
+#include "Particle.hpp"
+#include "StaticColliders.hpp"
+
+void StaticColliders::Add(const Vector2& position, float radius, Color color) {
+    m_x.push_back(position.x);
+    m_y.push_back(position.y);
+    m_radius.push_back(radius);
+    m_color.push_back(color);
+    m_maxRadius = std::max(m_maxRadius, radius);
+    m_built = false;
+}
+
+void StaticColliders::Clear() {
+    m_x.clear();
+    m_y.clear();
+    m_radius.clear();
+    m_color.clear();
+    m_maxRadius = 0.0f;
+    m_built = false;
+}
+
+void StaticColliders::EnsureBuilt(float dynamicMaxRadius) {
+    // a particle and a collider touching are at most this far apart
+    const float reach = m_maxRadius + dynamicMaxRadius;
+    if (m_built && reach <= m_cellSize) {
+        return;
+    }
+    m_cellSize = reach;
+    m_grid.Build(m_x.data(), m_y.data(), Size(), m_cellSize);
+    m_built = true;
+}
+
+void StaticColliders::Resolve(ParticleStore& particles, size_t start, size_t end) const {
+    if (Size() == 0) {
+        return;
+    }
+    const uint32_t* sorted = m_grid.SortedIndices();
+    for (size_t i = start; i < end; i++) {
+        // fixed and sleeping particles don't move into colliders
+        if (particles.flags[i] != 0) {
+            continue;
+        }
+        Particle particle(particles, i);
+        const Vector2 position = particle.GetPosition();
+        const int32_t cx = m_grid.CellX(position.x);
+        const int32_t cy = m_grid.CellY(position.y);
+        if (cx < -1 || cy < -1 || cx > m_grid.Columns() || cy > m_grid.Rows()) {
+            // nowhere near any collider, the common case
+            continue;
+        }
+        for (int32_t ny = cy - 1; ny <= cy + 1; ny++) {
+            for (int32_t nx = cx - 1; nx <= cx + 1; nx++) {
+                if (!m_grid.IsInside(nx, ny)) {
+                    continue;
+                }
+                const size_t cell = m_grid.CellIndex(nx, ny);
+                for (uint32_t slot = m_grid.CellStart(cell), slotsEnd = slot + m_grid.CellCount(cell); slot < slotsEnd; slot++) {
+                    const uint32_t collider = sorted[slot];
+                    Particle::ResolveStaticCollision(particle, GetPosition(collider), m_radius[collider]);
+                }
+            }
+        }
+    }
+}
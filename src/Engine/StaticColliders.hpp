@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <raylib.h>
+#include "ParticleStore.hpp"
+#include "UniformGrid.hpp"
+
+/// Fixed particles, kept apart from the simulated ones.
+/// They never move, so they are not integrated, not binned every substep and
+/// never tested against each other. Their grid is built once (again only when a
+/// collider is added or the dynamic particles outgrow its cells) and every
+/// dynamic particle just looks up the 3x3 cells around it.
+class StaticColliders {
+public:
+    void Add(const Vector2& position, float radius, Color color);
+    void Clear();
+
+    inline size_t Size() const {
+        return m_x.size();
+    }
+
+    inline Vector2 GetPosition(size_t index) const {
+        return Vector2 { m_x[index], m_y[index] };
+    }
+
+    inline float GetRadius(size_t index) const {
+        return m_radius[index];
+    }
+
+    inline Color GetColor(size_t index) const {
+        return m_color[index];
+    }
+
+    // raw arrays, for snapshots
+    inline const float* Xs() const {
+        return m_x.data();
+    }
+
+    inline const float* Ys() const {
+        return m_y.data();
+    }
+
+    inline const float* Radii() const {
+        return m_radius.data();
+    }
+
+    inline const Color* Colors() const {
+        return m_color.data();
+    }
+
+    // makes sure the grid reaches every collider a particle up to `dynamicMaxRadius` can touch
+    void EnsureBuilt(float dynamicMaxRadius);
+
+    // pushes the non fixed particles of [start, end) out of the colliders,
+    // ranges can run in parallel since colliders are only read
+    void Resolve(ParticleStore& particles, size_t start, size_t end) const;
+
+private:
+    std::vector<float> m_x, m_y, m_radius;
+    std::vector<Color> m_color;
+    float m_maxRadius = 0.0f;
+
+    UniformGrid m_grid;
+    bool m_built = false;
+    float m_cellSize = 0.0f;
+};
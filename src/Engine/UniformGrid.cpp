@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cfloat>
+#include "UniformGrid.hpp"
+
+void UniformGrid::Build(const float* xs, const float* ys, size_t count, float cellSize) {
+    m_cellSize = cellSize;
+    m_incremental = false;
+    if (count == 0) {
+        m_columns = m_rows = 0;
+        return;
+    }
+    computeBounds(xs, ys, count, 0);
+
+    // assign() and resize() keep the capacity, so these only allocate when the grid grows
+    const size_t cellsCount = CellsCount();
+    m_cellCount.assign(cellsCount, 0);
+    m_cellStart.resize(cellsCount);
+    m_cellCursor.resize(cellsCount);
+    m_sortedIndices.resize(count);
+    m_particleCell.resize(count);
+
+    // 1. count particles per cell
+    for (size_t i = 0; i < count; i++) {
+        int32_t cx = gridCoord(xs[i], m_originX);
+        int32_t cy = gridCoord(ys[i], m_originY);
+        uint32_t cell = (uint32_t)CellIndex(cx, cy);
+        m_particleCell[i] = cell;
+        m_cellCount[cell]++;
+    }
+
+    // 2. exclusive prefix sum gives the first slot of every cell
+    uint32_t offset = 0;
+    for (size_t cell = 0; cell < cellsCount; cell++) {
+        m_cellStart[cell] = offset;
+        m_cellCursor[cell] = offset;
+        offset += m_cellCount[cell];
+    }
+
+    // 3. scatter particle indices into their cell slots
+    for (size_t i = 0; i < count; i++) {
+        m_sortedIndices[m_cellCursor[m_particleCell[i]]++] = (uint32_t)i;
+    }
+}
+
+void UniformGrid::computeBounds(const float* xs, const float* ys, size_t count, int32_t padding) {
+    // grid only covers the area actually occupied by particles
+    float minX = FLT_MAX, minY = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (size_t i = 0; i < count; i++) {
+        minX = std::min(minX, xs[i]);
+        minY = std::min(minY, ys[i]);
+        maxX = std::max(maxX, xs[i]);
+        maxY = std::max(maxY, ys[i]);
+    }
+    m_originX = minX - padding * m_cellSize;
+    m_originY = minY - padding * m_cellSize;
+    m_columns = gridCoord(maxX, minX) + 1 + padding * 2;
+    m_rows = gridCoord(maxY, minY) + 1 + padding * 2;
+}
+
+size_t UniformGrid::Update(const float* xs, const float* ys, size_t count, float cellSize, mt::ThreadPool& threadPool) {
+    if (!m_incremental || count != m_particleCell.size() || cellSize != m_cellSize) {
+        m_cellSize = cellSize;
+        rebuildSlots(xs, ys, count);
+        return count;
+    }
+
+    // 1. new cell of every particle and how many moved, in parallel. fixed chunks (not the
+    // pool's ranges) so the movers can be listed in index order whatever the thread count
+    const float invCellSize = 1.0f / m_cellSize;
+    const size_t chunksCount = (count + migrationChunk - 1) / migrationChunk;
+    m_chunkMovers.resize(chunksCount);
+    std::atomic<bool> leftBounds = { false };
+    threadPool.dispatch(chunksCount, [&](size_t chunkStart, size_t chunkEnd) {
+        for (size_t chunk = chunkStart; chunk < chunkEnd; chunk++) {
+            const size_t end = std::min(count, (chunk + 1) * migrationChunk);
+            uint32_t movers = 0;
+            for (size_t i = chunk * migrationChunk; i < end; i++) {
+                const float fx = (xs[i] - m_originX) * invCellSize;
+                const float fy = (ys[i] - m_originY) * invCellSize;
+                if (!(fx >= 0.0f && fy >= 0.0f && fx < m_columns && fy < m_rows)) {
+                    leftBounds.store(true, std::memory_order_relaxed);
+                    m_newCell[i] = m_particleCell[i];
+                    continue;
+                }
+                m_newCell[i] = (uint32_t)CellIndex((int32_t)fx, (int32_t)fy);
+                movers += m_newCell[i] != m_particleCell[i];
+            }
+            m_chunkMovers[chunk] = movers;
+        }
+    }, 1);
+    if (leftBounds) {
+        rebuildSlots(xs, ys, count);
+        return count;
+    }
+
+    // 2. list the movers in index order, every chunk writes after the ones before it
+    uint32_t moversCount = 0;
+    for (size_t chunk = 0; chunk < chunksCount; chunk++) {
+        const uint32_t movers = m_chunkMovers[chunk];
+        m_chunkMovers[chunk] = moversCount;
+        moversCount += movers;
+    }
+    if (moversCount == 0) {
+        return 0;
+    }
+    m_movers.resize(moversCount);
+    threadPool.dispatch(chunksCount, [&](size_t chunkStart, size_t chunkEnd) {
+        for (size_t chunk = chunkStart; chunk < chunkEnd; chunk++) {
+            const size_t end = std::min(count, (chunk + 1) * migrationChunk);
+            uint32_t* movers = &m_movers[m_chunkMovers[chunk]];
+            for (size_t i = chunk * migrationChunk; i < end; i++) {
+                if (m_newCell[i] != m_particleCell[i]) {
+                    *movers++ = (uint32_t)i;
+                }
+            }
+        }
+    }, 1);
+
+    // 3. relocate, every worker owns a band of cells and applies the moves touching it in
+    // index order. a cell sees the same removals and insertions in the same order whatever
+    // the thread count, so the layout stays deterministic
+    const size_t cellsCount = CellsCount();
+    const size_t bandsCount = std::min<size_t>(std::max<size_t>(1, threadPool.threadCount), cellsCount);
+    std::atomic<bool> overflow = { false };
+    threadPool.dispatch(bandsCount, [&](size_t bandStart, size_t bandEnd) {
+        const uint32_t firstCell = (uint32_t)(bandStart * cellsCount / bandsCount);
+        const uint32_t endCell = (uint32_t)(bandEnd * cellsCount / bandsCount);
+        for (const uint32_t i : m_movers) {
+            const uint32_t oldCell = m_particleCell[i];
+            if (oldCell >= firstCell && oldCell < endCell) {
+                // swap remove from the old slice, cells only hold a handful of particles
+                uint32_t* slots = &m_sortedIndices[m_cellStart[oldCell]];
+                const uint32_t last = --m_cellCount[oldCell];
+                for (uint32_t s = 0; s < last; s++) {
+                    if (slots[s] == i) {
+                        slots[s] = slots[last];
+                        break;
+                    }
+                }
+            }
+            const uint32_t cell = m_newCell[i];
+            if (cell >= firstCell && cell < endCell) {
+                if (m_cellCount[cell] == m_slotCapacity) {
+                    overflow.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                m_sortedIndices[m_cellStart[cell] + m_cellCount[cell]++] = i;
+            }
+        }
+    }, 1);
+    if (overflow) {
+        rebuildSlots(xs, ys, count);
+        return count;
+    }
+    // movers were the only particles whose cell changed
+    m_particleCell.swap(m_newCell);
+    return moversCount;
+}
+
+void UniformGrid::rebuildSlots(const float* xs, const float* ys, size_t count) {
+    m_particleCell.resize(count);
+    m_newCell.resize(count);
+    if (count == 0) {
+        m_columns = m_rows = 0;
+        m_incremental = false;
+        return;
+    }
+    computeBounds(xs, ys, count, boundsPadding);
+
+    const size_t cellsCount = CellsCount();
+    m_cellCount.assign(cellsCount, 0);
+    uint32_t maxCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cell = (uint32_t)CellIndex(gridCoord(xs[i], m_originX), gridCoord(ys[i], m_originY));
+        m_particleCell[i] = cell;
+        maxCount = std::max(maxCount, ++m_cellCount[cell]);
+    }
+
+    // a little room over the densest cell, slices stay small and cache friendly
+    m_slotCapacity = std::max(minSlotCapacity, maxCount + 2);
+    m_cellStart.resize(cellsCount);
+    for (size_t cell = 0; cell < cellsCount; cell++) {
+        m_cellStart[cell] = (uint32_t)(cell * m_slotCapacity);
+        m_cellCount[cell] = 0;
+    }
+    m_sortedIndices.resize(cellsCount * m_slotCapacity);
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t cell = m_particleCell[i];
+        m_sortedIndices[m_cellStart[cell] + m_cellCount[cell]++] = (uint32_t)i;
+    }
+    m_incremental = true;
+}
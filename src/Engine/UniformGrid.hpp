@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utils/ThreadPool.hpp"
+
+/// Dense uniform grid built with a counting sort.
+/// Particles are binned into a flat, bounds-sized array of cells in three passes
+/// (count -> prefix sum -> scatter), so a cell is just a contiguous slice of
+/// `m_sortedIndices`. All buffers are kept between builds and only grow,
+/// so steady state rebuilds do not allocate.
+///
+/// Update() keeps the grid between calls instead: every cell owns a fixed number
+/// of slots in `m_sortedIndices`, and only particles whose cell changed are moved
+/// from one slice to another, in parallel by workers owning disjoint bands of cells.
+/// Either way a cell is still CellStart/CellCount.
+class UniformGrid {
+public:
+    // empty cells around the particles in incremental mode, so they can spread a bit
+    // before the grid has to be rebuilt
+    static constexpr int32_t boundsPadding = 4;
+    static constexpr uint32_t minSlotCapacity = 4;
+    // particles per chunk when Update looks for the ones that changed cell
+    static constexpr size_t migrationChunk = 4096;
+
+    void Build(const float* xs, const float* ys, size_t count, float cellSize);
+
+    // incremental build, returns how many particles changed cell (all of them when
+    // the grid had to be rebuilt: new particles, new cell size, a particle left the
+    // bounds or a cell ran out of slots)
+    size_t Update(const float* xs, const float* ys, size_t count, float cellSize, mt::ThreadPool& threadPool);
+
+    // forces the next Update to rebuild, needed when particle indices change
+    inline void Invalidate() {
+        m_incremental = false;
+    }
+
+    inline int32_t Columns() const {
+        return m_columns;
+    }
+
+    inline int32_t Rows() const {
+        return m_rows;
+    }
+
+    inline size_t CellsCount() const {
+        return (size_t)m_columns * m_rows;
+    }
+
+    inline size_t CellIndex(int32_t cx, int32_t cy) const {
+        return (size_t)cy * m_columns + cx;
+    }
+
+    inline bool IsInside(int32_t cx, int32_t cy) const {
+        return cx >= 0 && cy >= 0 && cx < m_columns && cy < m_rows;
+    }
+
+    inline uint32_t CellStart(size_t cell) const {
+        return m_cellStart[cell];
+    }
+
+    inline uint32_t CellCount(size_t cell) const {
+        return m_cellCount[cell];
+    }
+
+    // column and row of any position, may be outside of the grid
+    inline int32_t CellX(float x) const {
+        return gridCoord(x, m_originX);
+    }
+
+    inline int32_t CellY(float y) const {
+        return gridCoord(y, m_originY);
+    }
+
+    // cell the particle was binned into by the last build
+    inline uint32_t ParticleCell(size_t index) const {
+        return m_particleCell[index];
+    }
+
+    // particle indices sorted by cell, slice a cell with CellStart/CellCount
+    inline const uint32_t* SortedIndices() const {
+        return m_sortedIndices.data();
+    }
+
+private:
+    float m_cellSize = 1.0f;
+    float m_originX = 0.0f, m_originY = 0.0f;
+    int32_t m_columns = 0, m_rows = 0;
+
+    std::vector<uint32_t> m_cellStart;
+    std::vector<uint32_t> m_cellCount;
+    std::vector<uint32_t> m_cellCursor;
+    std::vector<uint32_t> m_sortedIndices;
+    std::vector<uint32_t> m_particleCell;
+
+    // incremental mode state
+    bool m_incremental = false;
+    uint32_t m_slotCapacity = minSlotCapacity;
+    std::vector<uint32_t> m_newCell;
+    // movers per chunk, then where each chunk's movers start in m_movers
+    std::vector<uint32_t> m_chunkMovers;
+    // particles that changed cell this update, in index order
+    std::vector<uint32_t> m_movers;
+
+    inline int32_t gridCoord(float value, float origin) const {
+        return (int32_t)((value - origin) / m_cellSize);
+    }
+
+    void computeBounds(const float* xs, const float* ys, size_t count, int32_t padding);
+    void rebuildSlots(const float* xs, const float* ys, size_t count);
+};
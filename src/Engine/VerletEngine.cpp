@@ -2,107 +2,583 @@
 #include <raymath.h>
 #include "VerletEngine.hpp"
 #include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
 #include "utils/ThreadPool.hpp"
 #include "GridHasher.hpp"
+#include "Snapshot.hpp"
 
 VerletEngine::VerletEngine(mt::ThreadPool& threadPool)
     : m_threadPool(threadPool)
+    , m_integrate(kernels::SelectIntegrateKernel())
     {}
 
 void VerletEngine::EnsureCapacity(size_t additionalCount) {
-    size_t requiredSize = m_particles.size() + additionalCount;
-    if (requiredSize > m_particles.capacity()) {
+    size_t requiredSize = m_particles.Size() + additionalCount;
+    if (requiredSize > m_particles.Capacity()) {
         size_t newCapacity = std::max(
             requiredSize + 1,
-            m_particles.capacity() * 3 / 2
+            m_particles.Capacity() * 3 / 2
         );
-        m_particles.reserve(newCapacity);
+        m_particles.Reserve(newCapacity);
     }
 }
 
-void VerletEngine::AddParticle(const Vector2& position, float radius, Color color) {
-    addParticle(position, radius, color, false);
+ParticleId VerletEngine::AddParticle(const Vector2& position, float radius, Color color) {
+    size_t index = m_particles.Add(position, radius, color);
+    maxParticleRadius = std::max(maxParticleRadius, radius);
+    minParticleRadius = index == 0 ? radius : std::min(minParticleRadius, radius);
+    m_idToIndex.push_back((uint32_t)index);
+    return m_particles.id[index];
 }
 
 void VerletEngine::AddFixedParticle(const Vector2& position, float radius, Color color) {
-    addParticle(position, radius, color, true);
+    m_staticColliders.Add(position, radius, color);
 }
 
-void VerletEngine::addParticle(const Vector2& position, float radius, Color color, bool isFixed) {
-    m_particles.emplace_back(position, radius, color, isFixed);
-    m_particleLocks.emplace_back(std::make_unique<std::mutex>());
-    maxParticleRadius = std::max(maxParticleRadius, radius);
+void VerletEngine::Clear() {
+    m_threadPool.wait();
+    m_particles.Clear();
+    m_staticColliders.Clear();
+    m_idToIndex.clear();
+    m_renderX.clear();
+    m_renderY.clear();
+    minParticleRadius = maxParticleRadius = 0.0f;
+    m_asleepCount = 0;
+    m_denseGrid.Invalidate();
+    m_neighborList.Invalidate();
+    m_generation++;
+}
+
+void VerletEngine::SetObstacles(SignedDistanceField obstacles) {
+    m_threadPool.wait();
+    m_obstacles = std::move(obstacles);
+    WakeAll();
 }
 
 size_t VerletEngine::ParticlesCount() const {
-    return m_particles.size();
+    return m_particles.Size();
 }
 
-void VerletEngine::Update(float dt) {
-    m_threadPool.dispatch(m_particles.size(), [&](size_t start, size_t end) {
+size_t VerletEngine::StaticCollidersCount() const {
+    return m_staticColliders.Size();
+}
+
+Particle VerletEngine::GetParticle(size_t index) {
+    return Particle(m_particles, index);
+}
+
+Particle VerletEngine::GetParticleById(ParticleId id) {
+    return Particle(m_particles, m_idToIndex[id]);
+}
+
+void VerletEngine::ReorderParticles() {
+    PROFILE_SCOPE(prof::Phase::Reorder);
+    m_threadPool.wait();
+    const size_t count = m_particles.Size();
+    const float cellSize = GetMaxParticleRadiusInSystem() * 2;
+    if (count == 0 || cellSize <= 0.0f) {
+        return;
+    }
+    m_mortonOrder.Sort(m_particles.x.data(), m_particles.y.data(), count, cellSize, m_threadPool);
+    const uint32_t* order = m_mortonOrder.Order();
+
+    applyOrder(m_particles.x, order);
+    applyOrder(m_particles.y, order);
+    applyOrder(m_particles.oldX, order);
+    applyOrder(m_particles.oldY, order);
+    applyOrder(m_particles.ax, order);
+    applyOrder(m_particles.ay, order);
+    applyOrder(m_particles.radius, order);
+    applyOrder(m_particles.color, order);
+    applyOrder(m_particles.flags, order);
+    applyOrder(m_particles.sleepSteps, order);
+    applyOrder(m_particles.id, order);
+    if (m_renderX.size() == count) {
+        // keep the interpolation snapshot lined up with the particles
+        applyOrder(m_renderX, order);
+        applyOrder(m_renderY, order);
+    }
+
+    const uint32_t* ids = m_particles.id.data();
+    m_threadPool.dispatch(count, [&](size_t start, size_t end) {
         for (size_t i = start; i < end; i++) {
-            Particle& particle = m_particles[i];
-            particle.Update(dt);
+            m_idToIndex[ids[i]] = (uint32_t)i;
         }
     });
+    // grid slots and neighbor lists still point at the old indices
+    m_denseGrid.Invalidate();
+    m_neighborList.Invalidate();
+    m_reordersCount++;
+}
+
+template <typename T>
+void VerletEngine::applyOrder(std::vector<T>& values, const uint32_t* order) {
+    // gather into the shared scratch bytes, then copy back, the scratch only grows
+    const size_t count = values.size();
+    m_reorderScratch.resize(std::max(m_reorderScratch.size(), count * sizeof(T)));
+    T* gathered = reinterpret_cast<T*>(m_reorderScratch.data());
+    m_threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            gathered[i] = values[order[i]];
+        }
+    });
+    // other ranges may still be reading any slot until the gather is done
+    m_threadPool.dispatch(count, [&](size_t start, size_t end) {
+        std::copy(gathered + start, gathered + end, values.begin() + start);
+    });
+}
+
+void VerletEngine::SaveRenderPositions() {
+    m_threadPool.wait();
+    m_renderX.assign(m_particles.x.begin(), m_particles.x.end());
+    m_renderY.assign(m_particles.y.begin(), m_particles.y.end());
+}
+
+void VerletEngine::PublishRenderState(RenderState& state, float interpolation) const {
+    m_threadPool.wait();
+    const size_t count = m_particles.Size();
+    state.x.resize(count);
+    state.y.resize(count);
+    state.radius.assign(m_particles.radius.begin(), m_particles.radius.end());
+    state.color.assign(m_particles.color.begin(), m_particles.color.end());
+    // particles spawned after the saved render positions have nothing to blend from
+    const size_t interpolatedCount = interpolation < 1.0f ? std::min(m_renderX.size(), count) : 0;
+    m_threadPool.dispatch(count, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            float x = m_particles.x[i], y = m_particles.y[i];
+            if (i < interpolatedCount) {
+                x = m_renderX[i] + (x - m_renderX[i]) * interpolation;
+                y = m_renderY[i] + (y - m_renderY[i]) * interpolation;
+            }
+            state.x[i] = x;
+            state.y[i] = y;
+        }
+    });
+    const size_t staticCount = m_staticColliders.Size();
+    state.staticX.assign(m_staticColliders.Xs(), m_staticColliders.Xs() + staticCount);
+    state.staticY.assign(m_staticColliders.Ys(), m_staticColliders.Ys() + staticCount);
+    state.staticRadius.assign(m_staticColliders.Radii(), m_staticColliders.Radii() + staticCount);
+    state.staticColor.assign(m_staticColliders.Colors(), m_staticColliders.Colors() + staticCount);
+    state.asleepCount = m_asleepCount;
+}
+
+void VerletEngine::Update(float dt) {
+    Update(dt, Vector2 { 0.0f, 0.0f });
+}
+
+void VerletEngine::Update(float dt, const Vector2& acceleration) {
+    PROFILE_SCOPE(prof::Phase::Integrate);
+    wakeOnAccelerationChange(acceleration);
+    // same math as Particle::Update, vectorized over the arrays
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        m_integrate(m_particles, start, end, acceleration, dt);
+    });
 }
 
 void VerletEngine::ApplyGravity(const Vector2& gravity) {
-    m_threadPool.dispatch(m_particles.size(), [&](size_t start, size_t end) {
+    PROFILE_SCOPE(prof::Phase::Forces);
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        float* ax = m_particles.ax.data();
+        float* ay = m_particles.ay.data();
+        const uint8_t* flags = m_particles.flags.data();
         for (size_t i = start; i < end; i++) {
-            Particle& particle = m_particles[i];
-            particle.ApplyForce(gravity);
+            // neither fixed nor asleep, sleepers don't pick up forces until they wake
+            if (flags[i] == 0) {
+                ax[i] += gravity.x;
+                ay[i] += gravity.y;
+            }
         }
     });
 }
 
 void VerletEngine::ApplyConstraints(uint32_t screenWidth, uint32_t screenHeight) {
-    m_threadPool.dispatch(m_particles.size(), [&](size_t start, size_t end) {
+    PROFILE_SCOPE(prof::Phase::Constraints);
+    m_worldWidth = screenWidth;
+    m_worldHeight = screenHeight;
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        applyConstraints(start, end, screenWidth, screenHeight);
+    });
+}
+
+void VerletEngine::Step(float dt, const Vector2& acceleration, uint32_t screenWidth, uint32_t screenHeight) {
+    PROFILE_SCOPE(prof::Phase::Step);
+    m_worldWidth = screenWidth;
+    m_worldHeight = screenHeight;
+    wakeOnAccelerationChange(acceleration);
+    // one dispatch instead of three, and every block is clamped right after it is
+    // integrated while it is still in cache
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        for (size_t blockStart = start; blockStart < end; blockStart += STEP_BLOCK_SIZE) {
+            const size_t blockEnd = std::min(blockStart + STEP_BLOCK_SIZE, end);
+            m_integrate(m_particles, blockStart, blockEnd, acceleration, dt);
+            applyConstraints(blockStart, blockEnd, screenWidth, screenHeight);
+        }
+    });
+}
+
+void VerletEngine::applyConstraints(size_t start, size_t end, uint32_t screenWidth, uint32_t screenHeight) {
+    const bool hasObstacles = !m_obstacles.IsEmpty();
+    for (size_t i = start; i < end; i++) {
+        Particle particle(m_particles, i);
+        Vector2 position = particle.GetPosition();
+        float radius = particle.GetRadius();
+        if (hasObstacles && !particle.IsStill() && m_obstacles.PushOut(position, radius)) {
+            // a fixed five field samples (distance and gradient) however complex the obstacles are
+            m_particles.x[i] = position.x;
+            m_particles.y[i] = position.y;
+            particle.SetVelocity(Vector2Scale(particle.GetVelocity(), Particle::dampening));
+        }
+        /// as an optimisation we can use bitwise operators
+        /// but I am lazy, and its will be less readable
+        bool changedX = false, changedY = false;
+        if (position.x - radius < 0) {
+            // Left
+            position.x = radius;
+            changedX = true;
+        }
+        if (position.x + radius > screenWidth) {
+            // Right
+            position.x = screenWidth - radius;
+            changedX = true;
+        }
+        if (position.y - radius < 0) {
+            // Top
+            position.y = radius;
+            changedY = true;
+        }
+        if (position.y + radius > screenHeight) {
+            // Bottom
+            position.y = screenHeight - radius;
+            changedY = true;
+        }
+        if (!changedX && !changedY) {
+            continue;
+        }
+        Vector2 velocity = particle.GetVelocity();
+        if (changedX) {
+            velocity.x *= -1 * Particle::dampening;
+        }
+        if (changedY) {
+            velocity.y *= -1 * Particle::dampening;
+        }
+        particle.SetPosition(position);
+        particle.SetVelocity(velocity);
+    }
+}
+
+// splitmix64 finalizer, turns consecutive numbers into independent looking bits
+static inline uint64_t mixBits(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+void VerletEngine::ResolveCollisions() {
+    m_passRandom = mixBits(m_seed ^ mixBits(m_collisionPasses++));
+    if (m_reorderInterval > 0 && ++m_passesSinceReorder >= m_reorderInterval) {
+        m_passesSinceReorder = 0;
+        ReorderParticles();
+    }
+    resolveParticleCollisions();
+    // pairs the broadphase handed to the narrow phase, for pairs/s
+    prof::Profiler::Instance().AddCount(prof::Counter::PairTests, m_pairTests.exchange(0, std::memory_order_relaxed));
+    resolveStaticCollisions();
+    if (FeatureFlags::Instance().IsEnabled(Feature::Sleeping)) {
+        updateSleeping();
+    } else if (m_asleepCount > 0) {
+        WakeAll();
+    }
+}
+
+uint64_t VerletEngine::ComputeStateHash() const {
+    m_threadPool.wait();
+    // FNV-1a over the raw bits, slots move with reorders so particles are visited by id
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto add = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    };
+    for (uint32_t index : m_idToIndex) {
+        add(&m_particles.x[index], sizeof(float));
+        add(&m_particles.y[index], sizeof(float));
+        add(&m_particles.oldX[index], sizeof(float));
+        add(&m_particles.oldY[index], sizeof(float));
+        add(&m_particles.flags[index], sizeof(uint8_t));
+    }
+    return hash;
+}
+
+bool VerletEngine::SaveSnapshot(const char* path) {
+    m_threadPool.wait();
+    // the incremental grid's slot order depends on its history, which isn't saved.
+    // rebuilding it here puts this run on the same grid a loaded snapshot starts with
+    m_denseGrid.Invalidate();
+    m_neighborList.Invalidate();
+    snapshot::Header header = {};
+    header.particlesCount = m_particles.Size();
+    header.staticCount = m_staticColliders.Size();
+    header.seed = m_seed;
+    header.collisionPasses = m_collisionPasses;
+    header.passesSinceReorder = m_passesSinceReorder;
+    header.iterateForward = m_iterateForward ? 1 : 0;
+    header.lastAccelerationX = m_lastAcceleration.x;
+    header.lastAccelerationY = m_lastAcceleration.y;
+
+    auto array = [](const auto& values) {
+        return snapshot::FieldData { values.data(), values.size() * sizeof(values[0]) };
+    };
+    const uint64_t staticBytes = m_staticColliders.Size() * sizeof(float);
+    // same order as snapshot::Field, accelerations are always zero between steps
+    const snapshot::FieldData fields[(size_t)snapshot::Field::Count] = {
+        array(m_particles.x),
+        array(m_particles.y),
+        array(m_particles.oldX),
+        array(m_particles.oldY),
+        array(m_particles.radius),
+        array(m_particles.color),
+        array(m_particles.flags),
+        array(m_particles.sleepSteps),
+        array(m_particles.id),
+        { m_staticColliders.Xs(), staticBytes },
+        { m_staticColliders.Ys(), staticBytes },
+        { m_staticColliders.Radii(), staticBytes },
+        { m_staticColliders.Colors(), m_staticColliders.Size() * sizeof(Color) },
+    };
+    return snapshot::Write(path, header, fields);
+}
+
+bool VerletEngine::LoadSnapshot(const char* path) {
+    snapshot::MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    const snapshot::Header& header = file.GetHeader();
+    const size_t count = (size_t)header.particlesCount;
+    // ids index m_idToIndex, they have to be exactly 0..count-1 in some order.
+    // out of range or repeated ids would leave slots of it pointing anywhere
+    const uint32_t* ids = file.Get<uint32_t>(snapshot::Field::Id);
+    std::vector<bool> seen(count, false);
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] >= count || seen[ids[i]]) {
+            return false;
+        }
+        seen[ids[i]] = true;
+    }
+
+    m_threadPool.wait();
+    // the arrays are copied straight out of the mapping, nothing is parsed
+    auto load = [&](auto& values, snapshot::Field field) {
+        using T = typename std::decay_t<decltype(values)>::value_type;
+        const T* source = file.Get<T>(field);
+        values.assign(source, source + count);
+    };
+    load(m_particles.x, snapshot::Field::X);
+    load(m_particles.y, snapshot::Field::Y);
+    load(m_particles.oldX, snapshot::Field::OldX);
+    load(m_particles.oldY, snapshot::Field::OldY);
+    load(m_particles.radius, snapshot::Field::Radius);
+    load(m_particles.color, snapshot::Field::Color);
+    load(m_particles.flags, snapshot::Field::Flags);
+    load(m_particles.sleepSteps, snapshot::Field::SleepSteps);
+    load(m_particles.id, snapshot::Field::Id);
+    m_particles.ax.assign(count, 0.0f);
+    m_particles.ay.assign(count, 0.0f);
+
+    m_idToIndex.resize(count);
+    m_asleepCount = 0;
+    minParticleRadius = maxParticleRadius = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        m_idToIndex[m_particles.id[i]] = (uint32_t)i;
+        m_asleepCount += (m_particles.flags[i] & ParticleStore::asleepFlag) != 0;
+        const float radius = m_particles.radius[i];
+        maxParticleRadius = std::max(maxParticleRadius, radius);
+        minParticleRadius = i == 0 ? radius : std::min(minParticleRadius, radius);
+    }
+    m_renderX = m_particles.x;
+    m_renderY = m_particles.y;
+
+    m_staticColliders.Clear();
+    const float* staticX = file.Get<float>(snapshot::Field::StaticX);
+    const float* staticY = file.Get<float>(snapshot::Field::StaticY);
+    const float* staticRadius = file.Get<float>(snapshot::Field::StaticRadius);
+    const Color* staticColor = file.Get<Color>(snapshot::Field::StaticColor);
+    for (size_t i = 0; i < header.staticCount; i++) {
+        m_staticColliders.Add(Vector2 { staticX[i], staticY[i] }, staticRadius[i], staticColor[i]);
+    }
+
+    m_seed = header.seed;
+    m_collisionPasses = header.collisionPasses;
+    m_passesSinceReorder = header.passesSinceReorder;
+    m_iterateForward = header.iterateForward != 0;
+    m_lastAcceleration = Vector2 { header.lastAccelerationX, header.lastAccelerationY };
+    // everything built from the old particles is stale
+    m_denseGrid.Invalidate();
+    m_neighborList.Invalidate();
+    m_generation++;
+    return true;
+}
+
+void VerletEngine::updateSleeping() {
+    // every pass gets its own stamp, 0 is what fresh cells hold
+    const uint32_t previousPass = m_wakePass;
+    if (++m_wakePass == 0) {
+        m_wakePass = 1;
+    }
+    // only worth tracking moving particles while there is somebody to wake
+    const bool trackMoving = m_asleepCount > 0 && prepareWakeCells();
+    const uint32_t pass = m_wakePass;
+    std::atomic<uint32_t>* movedCells = trackMoving ? m_wakeCells[pass & 1].get() : nullptr;
+    // the previous pass only counts on the same grid, its cells hold older stamps if it
+    // didn't track anything
+    const std::atomic<uint32_t>* movedBefore = trackMoving && previousPass + 1 == pass
+        ? m_wakeCells[previousPass & 1].get() : nullptr;
+    std::atomic<size_t> asleepCount = { 0 };
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        size_t asleep = 0;
         for (size_t i = start; i < end; i++) {
-            Particle& particle = m_particles[i];
-            Vector2 position = particle.GetPosition();
-            float radius = particle.GetRadius();
-            /// as an optimisation we can use bitwise operators
-            /// but I am lazy, and its will be less readable
-            bool changedX = false, changedY = false;
-            if (position.x - radius < 0) {
-                // Left
-                position.x = radius;
-                changedX = true;
-            }
-            if (position.x + radius > screenWidth) {
-                // Right
-                position.x = screenWidth - radius;
-                changedX = true;
-            }
-            if (position.y - radius < 0) {
-                // Top
-                position.y = radius;
-                changedY = true;
-            }
-            if (position.y + radius > screenHeight) {
-                // Bottom
-                position.y = screenHeight - radius;
-                changedY = true;
-            }
-            if (!changedX && !changedY) {
+            Particle particle(m_particles, i);
+            if (particle.IsAsleep()) {
+                // the stamps of the previous pass are final, so who wakes doesn't depend on the workers
+                if (movedBefore && isNextToMoving(m_particles.x[i], m_particles.y[i], movedBefore, previousPass)) {
+                    particle.Wake();
+                } else {
+                    asleep++;
+                }
                 continue;
             }
-            Vector2 velocity = particle.GetVelocity();
-            if (changedX) {
-                velocity.x *= -1 * Particle::dampening;
+            if (particle.IsFixed()) {
+                continue;
             }
-            if (changedY) {
-                velocity.y *= -1 * Particle::dampening;
+            const Vector2 velocity = particle.GetVelocity();
+            const float speedSquared = velocity.x * velocity.x + velocity.y * velocity.y;
+            if (speedSquared > Particle::sleepSpeed * Particle::sleepSpeed) {
+                m_particles.sleepSteps[i] = 0;
+                if (movedCells && speedSquared > Particle::wakeSpeed * Particle::wakeSpeed) {
+                    std::atomic<uint32_t>& stamp = movedCells[wakeCell(wakeColumn(m_particles.x[i]), wakeRow(m_particles.y[i]))];
+                    // most movers share their cell with others, don't fight over the cache line
+                    if (stamp.load(std::memory_order_relaxed) != pass) {
+                        stamp.store(pass, std::memory_order_relaxed);
+                    }
+                }
+            } else if (++m_particles.sleepSteps[i] >= SLEEP_STEPS) {
+                particle.Sleep();
+                asleep++;
             }
-            particle.SetPosition(position);
-            particle.SetVelocity(velocity);
         }
+        asleepCount.fetch_add(asleep, std::memory_order_relaxed);
     });
+    m_asleepCount = asleepCount;
 }
 
-void VerletEngine::ResolveCollisions() {
-    if (FeatureFlags::Instance().IsEnabled(Feature::SpatialHash)) {
+bool VerletEngine::prepareWakeCells() {
+    // two radii per cell, so anything touching a particle is at most one cell away
+    const float cellSize = 2.0f * maxParticleRadius;
+    if (cellSize <= 0.0f || m_worldWidth == 0 || m_worldHeight == 0) {
+        return false;
+    }
+    const int32_t columns = (int32_t)(m_worldWidth / cellSize) + 1;
+    const int32_t rows = (int32_t)(m_worldHeight / cellSize) + 1;
+    if (cellSize != m_wakeCellSize || columns != m_wakeColumns || rows != m_wakeRows) {
+        m_wakeCellSize = cellSize;
+        m_wakeColumns = columns;
+        m_wakeRows = rows;
+        const size_t cellsCount = (size_t)columns * rows;
+        if (cellsCount > m_wakeCellsCapacity) {
+            m_wakeCells[0].reset(new std::atomic<uint32_t>[cellsCount]());
+            m_wakeCells[1].reset(new std::atomic<uint32_t>[cellsCount]());
+            m_wakeCellsCapacity = cellsCount;
+        }
+        // stamps of the old layout point at other cells, skip a pass so none of them is read
+        if (++m_wakePass == 0) {
+            m_wakePass = 1;
+        }
+    }
+    return true;
+}
+
+bool VerletEngine::isNextToMoving(float x, float y, const std::atomic<uint32_t>* cells, uint32_t pass) const {
+    const int32_t cx = wakeColumn(x);
+    const int32_t cy = wakeRow(y);
+    for (int32_t row = std::max(cy - 1, 0); row <= std::min(cy + 1, m_wakeRows - 1); row++) {
+        for (int32_t column = std::max(cx - 1, 0); column <= std::min(cx + 1, m_wakeColumns - 1); column++) {
+            if (cells[wakeCell(column, row)].load(std::memory_order_relaxed) == pass) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void VerletEngine::WakeAll() {
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            Particle(m_particles, i).Wake();
+        }
+    });
+    m_asleepCount = 0;
+}
+
+void VerletEngine::WakeAround(const Vector2& position, float radius) {
+    if (m_asleepCount == 0) {
+        return;
+    }
+    m_threadPool.wait();
+    const float radiusSquared = radius * radius;
+    for (size_t i = 0; i < m_particles.Size(); i++) {
+        const float dx = m_particles.x[i] - position.x;
+        const float dy = m_particles.y[i] - position.y;
+        if (dx * dx + dy * dy <= radiusSquared) {
+            Particle(m_particles, i).Wake();
+        }
+    }
+    // the exact count is back after the next collision pass
+}
+
+void VerletEngine::wakeOnAccelerationChange(const Vector2& acceleration) {
+    if (acceleration.x != m_lastAcceleration.x || acceleration.y != m_lastAcceleration.y) {
+        m_lastAcceleration = acceleration;
+        if (m_asleepCount > 0) {
+            WakeAll();
+        }
+    }
+}
+
+void VerletEngine::resolveParticleCollisions() {
+    if (FeatureFlags::Instance().IsEnabled(Feature::Deterministic)) {
+        // strips are cut from grid columns, not from the thread count, and a strip is
+        // walked in a fixed order by one worker. the lock based modes resolve in
+        // whatever order the locks are won, so they are skipped
+        releaseParticleLocks();
+        resolveCollisionsLockFree();
+        return;
+    }
+    if (FeatureFlags::Instance().IsEnabled(Feature::NeighborList)) {
+        ensureParticleLocks();
+        resolveCollisionsWithNeighborList();
+        return;
+    }
+    // with a single radius there is only one level, the other modes handle that better
+    if (FeatureFlags::Instance().IsEnabled(Feature::MultiLevelGrid) && minParticleRadius < maxParticleRadius) {
+        ensureParticleLocks();
+        resolveCollisionsWithMultiLevelGrid();
+        return;
+    }
+    if (FeatureFlags::Instance().IsEnabled(Feature::LockFreeSolve)) {
+        releaseParticleLocks();
+        resolveCollisionsLockFree();
+        return;
+    }
+    ensureParticleLocks();
+    if (FeatureFlags::Instance().IsEnabled(Feature::DenseGrid)) {
+        if (FeatureFlags::Instance().IsEnabled(Feature::StreamingCollisions)) {
+            resolveCollisionsStreaming();
+        } else {
+            resolveCollisionsWithDenseGrid();
+        }
+    } else if (FeatureFlags::Instance().IsEnabled(Feature::SpatialHash)) {
         resolveCollisionsWithSpatialHashing();
     } else {
         resolveCollisionsWithNxNComparisons();
@@ -115,74 +591,394 @@ void VerletEngine::resolveCollisionsWithSpatialHashing() {
     GridHasher grid(cellSize);
     std::unordered_map<int64_t, std::vector<size_t>> spatialGrid;
 
-    // Fill grid
-    for (size_t i = 0; i < m_particles.size(); i++) {
-        const Vector2& pos = m_particles[i].GetPosition();
-        int32_t gx = grid.GridCoord(pos.x);
-        int32_t gy = grid.GridCoord(pos.y);
-        int64_t hashValue = grid.Hash(gx, gy);
-        spatialGrid[hashValue].push_back(i);
+    {
+        PROFILE_SCOPE(prof::Phase::GridBuild);
+        // Fill grid
+        for (size_t i = 0; i < m_particles.Size(); i++) {
+            const Vector2 pos = Vector2 { m_particles.x[i], m_particles.y[i] };
+            int32_t gx = grid.GridCoord(pos.x);
+            int32_t gy = grid.GridCoord(pos.y);
+            int64_t hashValue = grid.Hash(gx, gy);
+            spatialGrid[hashValue].push_back(i);
+        }
     }
 
+    if (FeatureFlags::Instance().IsEnabled(Feature::StreamingCollisions)) {
+        resolveSpatialHashStreaming(grid, spatialGrid);
+        return;
+    }
 
     // Check collisions
-    std::vector<std::pair<size_t, size_t>> possibleCollisionPairs;
-    possibleCollisionPairs.reserve(spatialGrid.size() * spatialGrid.size());
+    std::vector<std::pair<size_t, size_t>>& possibleCollisionPairs = m_collisionPairs;
+    possibleCollisionPairs.clear();
 
-    for (const auto& cell : spatialGrid) {
-        int64_t hash = cell.first;
-        const auto& indicesA = cell.second;
-        int32_t gx = (int32_t)(hash >> 32);
-        int32_t gy = (int32_t)(hash & 0xFFFFFFFF);
-
-        for (const int ox : this->DIR_X) {
-            for (const int oy : this->DIR_Y) {
-                int64_t neighborHash = grid.Hash(gx + ox, gy + oy);
-                if (spatialGrid.find(neighborHash) == spatialGrid.end()) {
+    {
+        PROFILE_SCOPE(prof::Phase::PairGeneration);
+        for (const auto& cell : spatialGrid) {
+            int64_t hash = cell.first;
+            const auto& indicesA = cell.second;
+            int32_t gx = (int32_t)(hash >> 32);
+            int32_t gy = (int32_t)(hash & 0xFFFFFFFF);
+
+            for (const int ox : this->DIR_X) {
+                for (const int oy : this->DIR_Y) {
+                    int64_t neighborHash = grid.Hash(gx + ox, gy + oy);
+                    if (spatialGrid.find(neighborHash) == spatialGrid.end()) {
+                        continue;
+                    }
+
+                    const auto& indicesB = spatialGrid[neighborHash];
+
+                    for (size_t i : indicesA) {
+                        for (size_t j : indicesB) {
+                            if (i >= j) {
+                                // Avoid double or self check
+                                continue;
+                            }
+                            possibleCollisionPairs.emplace_back(i, j);
+
+                        }
+                    }
+                }
+            }
+        }
+    }
+    resolveCollisionPairs(possibleCollisionPairs);
+}
+
+void VerletEngine::resolveCollisionsWithDenseGrid() {
+    buildDenseGrid();
+
+    {
+        PROFILE_SCOPE(prof::Phase::PairGeneration);
+        const uint32_t* sorted = m_denseGrid.SortedIndices();
+        m_collisionPairs.clear();
+        for (int32_t cy = 0; cy < m_denseGrid.Rows(); cy++) {
+            for (int32_t cx = 0; cx < m_denseGrid.Columns(); cx++) {
+                const size_t cell = m_denseGrid.CellIndex(cx, cy);
+                const uint32_t countA = m_denseGrid.CellCount(cell);
+                if (countA == 0) {
                     continue;
                 }
+                const uint32_t* indicesA = sorted + m_denseGrid.CellStart(cell);
 
-                const auto& indicesB = spatialGrid[neighborHash];
+                // pairs inside the same cell
+                for (uint32_t i = 0; i < countA; i++) {
+                    for (uint32_t j = i + 1; j < countA; j++) {
+                        m_collisionPairs.emplace_back(indicesA[i], indicesA[j]);
+                    }
+                }
 
-                for (size_t i : indicesA) {
-                    for (size_t j : indicesB) {
-                        if (i >= j) {
-                            // Avoid double or self check
-                            continue;
+                for (int d = 0; d < 4; d++) {
+                    const int32_t nx = cx + HALF_DIR_X[d];
+                    const int32_t ny = cy + HALF_DIR_Y[d];
+                    if (!m_denseGrid.IsInside(nx, ny)) {
+                        continue;
+                    }
+                    const size_t neighbor = m_denseGrid.CellIndex(nx, ny);
+                    const uint32_t countB = m_denseGrid.CellCount(neighbor);
+                    const uint32_t* indicesB = sorted + m_denseGrid.CellStart(neighbor);
+                    for (uint32_t i = 0; i < countA; i++) {
+                        for (uint32_t j = 0; j < countB; j++) {
+                            m_collisionPairs.emplace_back(indicesA[i], indicesB[j]);
                         }
-                        possibleCollisionPairs.emplace_back(i, j);
+                    }
+                }
+            }
+        }
+    }
+    resolveCollisionPairs(m_collisionPairs);
+}
 
+void VerletEngine::buildDenseGrid() {
+    PROFILE_SCOPE(prof::Phase::GridBuild);
+    // largest radius particle's diameter is cell size, same as spatial hashing
+    const float cellSize = GetMaxParticleRadiusInSystem() * 2;
+    if (FeatureFlags::Instance().IsEnabled(Feature::IncrementalGrid)) {
+        // settled particles stay in their cell, only the ones that moved are relocated
+        size_t migrated = m_denseGrid.Update(
+            m_particles.x.data(), m_particles.y.data(), m_particles.Size(), cellSize, m_threadPool
+        );
+        prof::Profiler& profiler = prof::Profiler::Instance();
+        profiler.AddCount(prof::Counter::GridParticles, m_particles.Size());
+        profiler.AddCount(prof::Counter::GridMigrations, migrated);
+    } else {
+        m_denseGrid.Build(m_particles.x.data(), m_particles.y.data(), m_particles.Size(), cellSize);
+    }
+    markAwakeCells();
+}
+
+void VerletEngine::markAwakeCells() {
+    m_skipSleepingCells = m_asleepCount > 0 && FeatureFlags::Instance().IsEnabled(Feature::Sleeping);
+    if (!m_skipSleepingCells) {
+        return;
+    }
+    m_cellAwake.assign(m_denseGrid.CellsCount(), 0);
+    // rows never share a cell, so every worker owns the flags it writes
+    const uint32_t* sorted = m_denseGrid.SortedIndices();
+    const size_t columns = (size_t)m_denseGrid.Columns();
+    m_threadPool.dispatch((size_t)m_denseGrid.Rows(), [&](size_t start, size_t end) {
+        for (size_t cell = start * columns; cell < end * columns; cell++) {
+            const uint32_t* indices = sorted + m_denseGrid.CellStart(cell);
+            for (uint32_t k = 0, count = m_denseGrid.CellCount(cell); k < count; k++) {
+                if (!(m_particles.flags[indices[k]] & ParticleStore::asleepFlag)) {
+                    m_cellAwake[cell] = 1;
+                    break;
+                }
+            }
+        }
+    });
+}
+
+void VerletEngine::resolveCollisionsLockFree() {
+    buildDenseGrid();
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+
+    // grid columns are split in strips of STRIP_WIDTH columns, a cell only touches
+    // its own and the next column, so strips of the same parity never share a particle.
+    // even strips run in parallel first, then odd strips, no locks required.
+    const int32_t columns = m_denseGrid.Columns();
+    const int32_t rows = m_denseGrid.Rows();
+    const size_t stripsCount = (size_t)(columns + STRIP_WIDTH - 1) / STRIP_WIDTH;
+    // iterating only one way piles the particles on one side, so alternate every pass
+    const bool forward = m_iterateForward;
+    m_iterateForward = !m_iterateForward;
+
+    for (size_t parity = 0; parity < 2; parity++) {
+        const size_t phaseStrips = (stripsCount + 1 - parity) / 2;
+        m_threadPool.dispatch(phaseStrips, [&](size_t start, size_t end) {
+            uint64_t tests = 0;
+            for (size_t s = start; s < end; s++) {
+                const int32_t firstColumn = (int32_t)(s * 2 + parity) * STRIP_WIDTH;
+                const int32_t lastColumn = std::min(firstColumn + STRIP_WIDTH, columns);
+                for (int32_t r = 0; r < rows; r++) {
+                    const int32_t cy = forward ? r : rows - 1 - r;
+                    for (int32_t cx = firstColumn; cx < lastColumn; cx++) {
+                        tests += resolveDenseCellCollisions<false>(m_denseGrid.CellIndex(cx, cy), cx, cy);
                     }
                 }
             }
+            m_pairTests.fetch_add(tests, std::memory_order_relaxed);
+        }, 1); // strip cost varies a lot with the pile height, let idle workers steal single strips
+    }
+}
+
+template <bool Locked>
+uint32_t VerletEngine::resolveDenseCellCollisions(size_t cell, int32_t cx, int32_t cy) {
+    const uint32_t countA = m_denseGrid.CellCount(cell);
+    if (countA == 0) {
+        return 0;
+    }
+    const uint32_t* sorted = m_denseGrid.SortedIndices();
+    const uint32_t* indicesA = sorted + m_denseGrid.CellStart(cell);
+    // two cells where everything sleeps have nothing to resolve
+    const bool sleepingA = m_skipSleepingCells && !m_cellAwake[cell];
+
+    uint32_t tests = 0;
+
+    // pairs inside the same cell
+    if (!sleepingA) {
+        for (uint32_t i = 0; i < countA; i++) {
+            for (uint32_t j = i + 1; j < countA; j++) {
+                resolvePairInPlace<Locked>(indicesA[i], indicesA[j]);
+            }
         }
+        tests += countA * (countA - 1) / 2;
     }
+
+    for (int d = 0; d < 4; d++) {
+        const int32_t nx = cx + HALF_DIR_X[d];
+        const int32_t ny = cy + HALF_DIR_Y[d];
+        if (!m_denseGrid.IsInside(nx, ny)) {
+            continue;
+        }
+        const size_t neighbor = m_denseGrid.CellIndex(nx, ny);
+        if (sleepingA && !m_cellAwake[neighbor]) {
+            continue;
+        }
+        const uint32_t countB = m_denseGrid.CellCount(neighbor);
+        const uint32_t* indicesB = sorted + m_denseGrid.CellStart(neighbor);
+        for (uint32_t i = 0; i < countA; i++) {
+            for (uint32_t j = 0; j < countB; j++) {
+                resolvePairInPlace<Locked>(indicesA[i], indicesB[j]);
+            }
+        }
+        tests += countA * countB;
+    }
+    return tests;
+}
+
+template <bool Locked>
+inline void VerletEngine::resolvePairInPlace(size_t idx1, size_t idx2) {
+    if constexpr (Locked) {
+        resolveParticlePairCollision(idx1, idx2);
+    } else {
+        Particle a(m_particles, idx1);
+        Particle b(m_particles, idx2);
+        if (Particle::CheckCollision(a, b)) {
+            Particle::ResolveCollision(a, b);
+        }
+    }
+}
+
+void VerletEngine::resolveCollisionsStreaming() {
+    buildDenseGrid();
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+
+    // every worker walks its own rows of cells and tests the neighbors right away,
+    // no pair is ever stored. rows overlap with their neighbors so pairs still take locks
+    const int32_t columns = m_denseGrid.Columns();
+    const int32_t rows = m_denseGrid.Rows();
+    const bool forward = m_iterateForward;
+    m_iterateForward = !m_iterateForward;
+    m_threadPool.dispatch((size_t)rows, [&](size_t start, size_t end) {
+        uint64_t tests = 0;
+        for (size_t r = start; r < end; r++) {
+            const int32_t cy = forward ? (int32_t)r : rows - 1 - (int32_t)r;
+            for (int32_t cx = 0; cx < columns; cx++) {
+                tests += resolveDenseCellCollisions<true>(m_denseGrid.CellIndex(cx, cy), cx, cy);
+            }
+        }
+        m_pairTests.fetch_add(tests, std::memory_order_relaxed);
+    });
+}
+
+void VerletEngine::resolveSpatialHashStreaming(
+    const GridHasher& grid,
+    const std::unordered_map<int64_t, std::vector<size_t>>& spatialGrid
+) {
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    // only the occupied cells are listed (O(particles)), pairs are resolved while walking them
+    std::vector<const std::pair<const int64_t, std::vector<size_t>>*> cells;
+    cells.reserve(spatialGrid.size());
+    for (const auto& cell : spatialGrid) {
+        cells.push_back(&cell);
+    }
+
+    m_threadPool.dispatch(cells.size(), [&](size_t start, size_t end) {
+        uint64_t tests = 0;
+        for (size_t c = start; c < end; c++) {
+            int64_t hash = cells[c]->first;
+            const auto& indicesA = cells[c]->second;
+            int32_t gx = (int32_t)(hash >> 32);
+            int32_t gy = (int32_t)(hash & 0xFFFFFFFF);
+
+            for (const int ox : this->DIR_X) {
+                for (const int oy : this->DIR_Y) {
+                    // find() only reads, so the map can be shared by all workers
+                    auto neighbor = spatialGrid.find(grid.Hash(gx + ox, gy + oy));
+                    if (neighbor == spatialGrid.end()) {
+                        continue;
+                    }
+                    for (size_t i : indicesA) {
+                        for (size_t j : neighbor->second) {
+                            if (i >= j) {
+                                // Avoid double or self check
+                                continue;
+                            }
+                            resolveParticlePairCollision(i, j);
+                            tests++;
+                        }
+                    }
+                }
+            }
+        }
+        m_pairTests.fetch_add(tests, std::memory_order_relaxed);
+    });
+}
+
+void VerletEngine::resolveCollisionPairs(const std::vector<std::pair<size_t, size_t>>& pairs) {
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    m_pairTests.fetch_add(pairs.size(), std::memory_order_relaxed);
     // resolve collision with multithreading
-    m_threadPool.dispatch(possibleCollisionPairs.size(), [&](size_t start, size_t end) {
+    m_threadPool.dispatch(pairs.size(), [&](size_t start, size_t end) {
         // iterate either forward or backward in each frame,
         // iterating only one side piles the particles on that side only
-        // this happens because of float precision
-        float probablity = (double)rand() / RAND_MAX;
-        bool shouldIterateForward = probablity < 0.5;
+        // this happens because of float precision.
+        // rand() is not thread safe, the coin comes from the pass bits and the range instead
+        bool shouldIterateForward = (mixBits(m_passRandom ^ start) & 1) != 0;
         if (shouldIterateForward) {
             for (size_t i = start; i < end; i++) {
-                auto [aIndex, bIndex] = possibleCollisionPairs[i];
+                auto [aIndex, bIndex] = pairs[i];
                 resolveParticlePairCollision(aIndex, bIndex);
             }
         } else {
             for (size_t i = end; i > start; i--) {
-                auto [aIndex, bIndex] = possibleCollisionPairs[i - 1];
+                auto [aIndex, bIndex] = pairs[i - 1];
                 resolveParticlePairCollision(aIndex, bIndex);
             }
         }
     });
 }
 
+void VerletEngine::resolveStaticCollisions() {
+    if (m_staticColliders.Size() == 0) {
+        return;
+    }
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    // built once, only looked up from here on
+    m_staticColliders.EnsureBuilt(GetMaxParticleRadiusInSystem());
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        m_staticColliders.Resolve(m_particles, start, end);
+    });
+}
+
+void VerletEngine::resolveCollisionsWithNeighborList() {
+    if (m_neighborList.NeedsRebuild(m_particles, m_threadPool)) {
+        PROFILE_SCOPE(prof::Phase::PairGeneration);
+        const float maxRadius = GetMaxParticleRadiusInSystem();
+        m_neighborList.Build(m_particles, maxRadius, maxRadius * NEIGHBOR_SKIN_FACTOR, m_threadPool);
+        prof::Profiler::Instance().AddCount(prof::Counter::NeighborListBuilds, 1);
+    }
+
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    m_pairTests.fetch_add(m_neighborList.PairsCount(), std::memory_order_relaxed);
+    const uint32_t* neighbors = m_neighborList.Neighbors();
+    m_threadPool.dispatch(m_particles.Size(), [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            const uint32_t* list = neighbors + m_neighborList.NeighborsStart(i);
+            for (uint32_t k = 0, count = m_neighborList.NeighborsCount(i); k < count; k++) {
+                // lists hold pairs that may touch soon, the check filters the rest
+                resolveParticlePairCollision(i, list[k]);
+            }
+        }
+    });
+}
+
+void VerletEngine::resolveCollisionsWithMultiLevelGrid() {
+    if (m_particles.Size() == 0) {
+        return;
+    }
+    {
+        PROFILE_SCOPE(prof::Phase::GridBuild);
+        // cells follow the particle sizes instead of the largest one
+        m_multiLevelGrid.Build(m_particles, GetMinParticleRadiusInSystem(), GetMaxParticleRadiusInSystem());
+    }
+
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    for (uint32_t level = 0; level < m_multiLevelGrid.LevelsCount(); level++) {
+        m_threadPool.dispatch(m_multiLevelGrid.LevelSize(level), [&](size_t start, size_t end) {
+            uint64_t tests = 0;
+            for (size_t local = start; local < end; local++) {
+                const uint32_t i = m_multiLevelGrid.ParticleIndex(level, (uint32_t)local);
+                m_multiLevelGrid.ForEachCandidate(level, (uint32_t)local, [&](uint32_t j) {
+                    resolveParticlePairCollision(i, j);
+                    tests++;
+                });
+            }
+            m_pairTests.fetch_add(tests, std::memory_order_relaxed);
+        });
+    }
+}
+
 void VerletEngine::resolveCollisionsWithNxNComparisons() {
-    for (size_t i = 0, end = m_particles.size() - 1; i < end; i += 1) {
+    PROFILE_SCOPE(prof::Phase::PairResolution);
+    const uint64_t count = m_particles.Size();
+    m_pairTests.fetch_add(count * (count - 1) / 2, std::memory_order_relaxed);
+    for (size_t i = 0, end = m_particles.Size() - 1; i < end; i += 1) {
         for (size_t j = i + 1; j <= end; j += 1) {
-            Particle& a = m_particles[i];
-            Particle& b = m_particles[j];
+            Particle a(m_particles, i);
+            Particle b(m_particles, j);
             if (Particle::CheckCollision(a, b)) {
                 Particle::ResolveCollision(a, b);
             }
@@ -190,6 +986,20 @@ void VerletEngine::resolveCollisionsWithNxNComparisons() {
     }
 }
 
+void VerletEngine::ensureParticleLocks() {
+    // locks are only needed by the pair based solvers, allocate them lazily
+    while (m_particleLocks.size() < m_particles.Size()) {
+        m_particleLocks.emplace_back(std::make_unique<std::mutex>());
+    }
+}
+
+void VerletEngine::releaseParticleLocks() {
+    if (!m_particleLocks.empty()) {
+        m_particleLocks.clear();
+        m_particleLocks.shrink_to_fit();
+    }
+}
+
 void VerletEngine::resolveParticlePairCollision(size_t idx1, size_t idx2) {
     if (idx1 > idx2) {
         // swap to Lock in consistent order
@@ -201,16 +1011,9 @@ void VerletEngine::resolveParticlePairCollision(size_t idx1, size_t idx2) {
     std::lock(*m_particleLocks[idx1], *m_particleLocks[idx2]);
     std::lock_guard<std::mutex> lockA(*m_particleLocks[idx1], std::adopt_lock);
     std::lock_guard<std::mutex> lockB(*m_particleLocks[idx2], std::adopt_lock);
-    Particle& a = m_particles[idx1];
-    Particle& b = m_particles[idx2];
+    Particle a(m_particles, idx1);
+    Particle b(m_particles, idx2);
     if (Particle::CheckCollision(a, b)) {
         Particle::ResolveCollision(a, b);
     }
-}
-
-void VerletEngine::Draw(const Texture2D* particleTexture) const {
-    m_threadPool.wait();
-    for (const auto& particle : m_particles) {
-        particle.Draw(particleTexture);
-    }
 }
\ No newline at end of file
@@ -1,37 +1,238 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include "Particle.hpp"
+#include "ParticleStore.hpp"
+#include "GridHasher.hpp"
+#include "HierarchicalGrid.hpp"
+#include "IntegrationKernels.hpp"
+#include "MortonOrder.hpp"
+#include "SignedDistanceField.hpp"
+#include "StaticColliders.hpp"
+#include "NeighborList.hpp"
+#include "RenderState.hpp"
+#include "UniformGrid.hpp"
 #include "utils/ThreadPool.hpp"
 
+// Stays attached to the same particle when the engine reorders its arrays
+using ParticleId = uint32_t;
+
+class ParticleRenderer;
+
 class VerletEngine {
 public:
+    // collision passes between two Morton reorders of the particle arrays
+    static constexpr uint32_t defaultReorderInterval = 120;
+
     VerletEngine(mt::ThreadPool& threadPool);
     void EnsureCapacity(size_t additionalCount);
-    void AddParticle(const Vector2& position, float radius, Color color);
+    ParticleId AddParticle(const Vector2& position, float radius, Color color);
+    // fixed particles become static colliders, they are not part of the particle arrays
     void AddFixedParticle(const Vector2& position, float radius, Color color);
+    // static geometry, already built. particles are pushed out of it with the world bounds
+    void SetObstacles(SignedDistanceField obstacles);
+    inline const SignedDistanceField& GetObstacles() const {
+        return m_obstacles;
+    }
+    inline const StaticColliders& GetStaticColliders() const {
+        return m_staticColliders;
+    }
+    // removes every particle and static collider, ids start over from 0
+    void Clear();
+    // changes whenever the particles are replaced rather than added to (Clear, LoadSnapshot),
+    // so observers know what they saw of them before is stale
+    inline uint64_t GetGeneration() const {
+        return m_generation;
+    }
     size_t ParticlesCount() const;
+    size_t StaticCollidersCount() const;
+    // index based access is only valid until the next reorder, keep ids to track a particle
+    Particle GetParticle(size_t index);
+    Particle GetParticleById(ParticleId id);
     void Update(float dt);
+    // integrates with an extra acceleration (gravity, wind) fused in, no separate force pass
+    void Update(float dt, const Vector2& acceleration);
     void ApplyConstraints(uint32_t screenWidth, uint32_t screenHeight);
     void ApplyGravity(const Vector2& gravity);
-    void Draw(const Texture2D* particleTexture) const;
+    // forces + integration + world bounds in a single pass over the particles,
+    // same result as Update(dt, acceleration) followed by ApplyConstraints
+    void Step(float dt, const Vector2& acceleration, uint32_t screenWidth, uint32_t screenHeight);
+    // remembers the current positions as the previous render state
+    void SaveRenderPositions();
+    // copies every particle between its saved render position (0) and its current one (1)
+    // into `state`, along with the static colliders
+    void PublishRenderState(RenderState& state, float interpolation = 1.0f) const;
+    // draws a published state and the obstacles. doesn't touch the particle arrays or the
+    // thread pool, so it can run while the next frame is simulated.
+    // with a renderer (and Feature::BatchedRendering) particles go out as a few big draw calls
+    void Draw(const RenderState& state, const Texture2D* particleTexture, ParticleRenderer* renderer = nullptr) const;
     void ResolveCollisions();
 
+    // 0 turns the periodic spatial reorder off
+    inline void SetReorderInterval(uint32_t collisionPasses) {
+        m_reorderInterval = collisionPasses;
+    }
+
+    // sorts the particle arrays along a Morton curve of their grid cells
+    void ReorderParticles();
+
+    inline uint64_t GetReordersCount() const {
+        return m_reordersCount;
+    }
+
+    // particles put to sleep by the Sleeping feature as of the last collision pass
+    inline size_t GetAsleepCount() const {
+        return m_asleepCount;
+    }
+
+    void WakeAll();
+    // wakes the sleepers around a point, e.g. where the user interacts
+    void WakeAround(const Vector2& position, float radius);
+
+    // seeds the per pass random numbers of the solvers, the same seed replays the same run
+    inline void SetSeed(uint64_t seed) {
+        m_seed = seed;
+        m_collisionPasses = 0;
+    }
+
+    // hash of every particle's state in id order, equal hashes mean bit identical runs
+    uint64_t ComputeStateHash() const;
+
+    // writes the particles, static colliders and solver state to `path` (see Snapshot.hpp).
+    // obstacles are not included, they belong to the scene setup like the world size
+    bool SaveSnapshot(const char* path);
+    // replaces all particles and static colliders with the ones saved at `path`,
+    // the current state is kept if the file can't be loaded
+    bool LoadSnapshot(const char* path);
+
     inline float GetMaxParticleRadiusInSystem() {
         return maxParticleRadius;
     }
+
+    inline float GetMinParticleRadiusInSystem() {
+        return minParticleRadius;
+    }
 private:
     mt::ThreadPool& m_threadPool;
+    // best integration kernel for this CPU
+    const kernels::IntegrateKernel m_integrate;
     float maxParticleRadius = 0;
-    std::vector<Particle> m_particles;
+    float minParticleRadius = 0;
+    ParticleStore m_particles;
+    StaticColliders m_staticColliders;
+    SignedDistanceField m_obstacles;
     std::vector<std::unique_ptr<std::mutex>> m_particleLocks;
+    // positions before the last step of a frame, for interpolated drawing
+    std::vector<float> m_renderX, m_renderY;
+    // slot of every particle id, updated by reorders
+    std::vector<uint32_t> m_idToIndex;
+
+    // spatial reorder state
+    MortonOrder m_mortonOrder;
+    std::vector<unsigned char> m_reorderScratch;
+    uint32_t m_reorderInterval = defaultReorderInterval;
+    uint32_t m_passesSinceReorder = 0;
+    uint64_t m_reordersCount = 0;
+
+    // steps a particle has to rest before it falls asleep
+    static constexpr uint16_t SLEEP_STEPS = 240;
+    size_t m_asleepCount = 0;
+    uint64_t m_generation = 0;
+    // cells holding at least one awake particle, only filled while something sleeps
+    std::vector<uint8_t> m_cellAwake;
+    bool m_skipSleepingCells = false;
+    // cells a moving particle was in, stamped with the sleeping pass so they never need
+    // clearing. passes alternate between the two arrays: sleepers in or next to a cell
+    // stamped by the previous pass wake up, whatever held them up may be moving away.
+    // independent of the broadphase in use
+    std::unique_ptr<std::atomic<uint32_t>[]> m_wakeCells[2];
+    size_t m_wakeCellsCapacity = 0;
+    int32_t m_wakeColumns = 0, m_wakeRows = 0;
+    float m_wakeCellSize = 0.0f;
+    uint32_t m_wakePass = 0;
+    // size of the area particles are kept in, from the last Step or ApplyConstraints
+    uint32_t m_worldWidth = 0, m_worldHeight = 0;
+    // a different global force wakes everybody up
+    Vector2 m_lastAcceleration = Vector2 { 0.0f, 0.0f };
+
+    // broadphase state kept between substeps to avoid reallocating every frame
+    UniformGrid m_denseGrid;
+    std::vector<std::pair<size_t, size_t>> m_collisionPairs;
+    NeighborList m_neighborList;
+    HierarchicalGrid m_multiLevelGrid;
+    // candidate pairs tested by the current collision pass, summed once per worker range
+    std::atomic<uint64_t> m_pairTests = { 0 };
+
+    // extra reach of the neighbor lists, relative to the largest radius. larger skins
+    // rebuild less often but hand more far away pairs to the solver
+    static constexpr float NEIGHBOR_SKIN_FACTOR = 1.0f;
 
     // Neighboring offsets for spatial hashing collision resolution
     const int32_t DIR_X[3] = { -1, 0, 1 };
     const int32_t DIR_Y[3] = { -1, 0, 1 };
 
-    void addParticle(const Vector2& position, float radius, Color color, bool isFixed);
+    // Half of the neighborhood (right column and the cell below) for dense grid walks,
+    // the other half is covered when the neighbor cell visits this one
+    static constexpr int32_t HALF_DIR_X[4] = { 1, 1, 1, 0 };
+    static constexpr int32_t HALF_DIR_Y[4] = { -1, 0, 1, 1 };
+
+    // Particles integrated and clamped together by Step, small enough to stay in L1
+    static constexpr size_t STEP_BLOCK_SIZE = 1024;
+
+    // Columns per strip in lock free mode, strips of the same parity never share a particle
+    static constexpr int32_t STRIP_WIDTH = 2;
+    // flips every lock free pass to alternate the walking direction
+    bool m_iterateForward = true;
+
+    // random bits of the current collision pass, derived from the seed and the pass number
+    // so workers never share a generator
+    uint64_t m_seed = 0;
+    uint64_t m_collisionPasses = 0;
+    uint64_t m_passRandom = 0;
+
+    template <typename T>
+    void applyOrder(std::vector<T>& values, const uint32_t* order);
+    void applyConstraints(size_t start, size_t end, uint32_t screenWidth, uint32_t screenHeight);
+    void ensureParticleLocks();
+    void releaseParticleLocks();
     void resolveParticlePairCollision(size_t idx1, size_t idx2);
+    // returns the number of pairs it tested
+    template <bool Locked>
+    uint32_t resolveDenseCellCollisions(size_t cell, int32_t cx, int32_t cy);
+    template <bool Locked>
+    void resolvePairInPlace(size_t idx1, size_t idx2);
+    void resolveCollisionPairs(const std::vector<std::pair<size_t, size_t>>& pairs);
     void resolveCollisionsWithSpatialHashing();
+    void buildDenseGrid();
+    void markAwakeCells();
+    void resolveCollisionsWithDenseGrid();
+    void resolveCollisionsLockFree();
+    void resolveCollisionsStreaming();
+    void resolveSpatialHashStreaming(
+        const GridHasher& grid,
+        const std::unordered_map<int64_t, std::vector<size_t>>& spatialGrid
+    );
+    void resolveParticleCollisions();
+    void updateSleeping();
+    // sizes the wake grid to the world and the largest radius, false if it can't be built
+    bool prepareWakeCells();
+    bool isNextToMoving(float x, float y, const std::atomic<uint32_t>* cells, uint32_t pass) const;
+    inline size_t wakeCell(int32_t cx, int32_t cy) const {
+        return (size_t)cy * m_wakeColumns + cx;
+    }
+    inline int32_t wakeColumn(float x) const {
+        return (int32_t)std::clamp(x / m_wakeCellSize, 0.0f, (float)(m_wakeColumns - 1));
+    }
+    inline int32_t wakeRow(float y) const {
+        return (int32_t)std::clamp(y / m_wakeCellSize, 0.0f, (float)(m_wakeRows - 1));
+    }
+    void wakeOnAccelerationChange(const Vector2& acceleration);
+    void resolveStaticCollisions();
+    void resolveCollisionsWithNeighborList();
+    void resolveCollisionsWithMultiLevelGrid();
     void resolveCollisionsWithNxNComparisons();
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include <assert.h>
 #include <random>
 #include "Game.hpp"
+#include "Engine/Scenes.hpp"
 #include "utils/FeatureFlags.hpp"
+#include "utils/Profiler.hpp"
+#include "utils/TraceRecorder.hpp"
 #include "utils/ThreadPool.hpp"
 
 Game::Game(mt::ThreadPool& threadPool, uint32_t screenWidth, uint32_t screenHeight, uint32_t frameRate)
@@ -10,15 +13,27 @@ Game::Game(mt::ThreadPool& threadPool, uint32_t screenWidth, uint32_t screenHeig
     , m_screenHeight(screenHeight)
     , m_running(true)
     , m_processInput(true)
-    , m_engine(threadPool) {
+    , m_engine(threadPool)
+    , m_simulation(m_engine, screenWidth, screenHeight)
+    , m_pipeline(m_simulation, m_engine) {
     InitWindow(m_screenWidth, m_screenHeight, "Verlet Game");
     SetTargetFPS(frameRate);
     LoadResources();
+    prof::Profiler::Instance().AttachThreadPool(&m_threadPool);
+    prof::TraceRecorder::Instance().SetThreadName("main");
     // seed random number generator
     srand(time(0));
 }
 
 Game::~Game() {
+    m_pipeline.Finish();
+    // flush a capture that is still running when the window closes
+    if (prof::TraceRecorder::Instance().IsRecording()) {
+        ToggleTrace();
+    }
+    if (m_recorder.IsRecording()) {
+        ToggleRecording();
+    }
     UnloadResources();
     CloseWindow();
 }
@@ -29,51 +44,19 @@ void Game::LoadResources() {
 
 void Game::UnloadResources() {
     UnloadTexture(m_particleTexture);
+    // its buffers belong to the GL context, so before CloseWindow
+    m_particleRenderer.Unload();
 }
 
 void Game::SpawnFixedParticles(
     const std::initializer_list<Vector2>& positions,
     float particleRadius
 ) {
-    // optional: it prevents frequent resize
-    m_engine.EnsureCapacity(positions.size());
-    for (const Vector2& position : positions) {
-        m_engine.AddFixedParticle(position, particleRadius, GRAY);
-    }
+    Scenes::SpawnFixedParticles(m_engine, positions, particleRadius);
 }
 
 void Game::SpawnParticles(const float probability, uint32_t limit, float particleRadius) {
-    assert(probability <= 1.0f);
-    m_engine.EnsureCapacity(limit); // optional: it prevents frequent resize
-    const float particleDiameter = particleRadius * 2;
-    const uint32_t rows = (uint32_t)round(m_screenHeight / particleDiameter);
-    const uint32_t columns = (uint32_t)round(m_screenWidth / particleDiameter);
-    const bool shouldCalculateChances = probability < 1.0f;
-    uint32_t actualLimit = std::min(limit, rows * columns);
-    /// ideally the column loop should be above and rows should be nested
-    /// BUT, I need to stop(break) particle creation if limit is reached and I want it to fill
-    /// in the order of top to bottom rather than left to right
-    for (uint32_t row = 0; row < rows && actualLimit > 0; row += 1) {
-        for (uint32_t col = 0; col < columns && actualLimit > 0; col += 1) {
-            if (shouldCalculateChances) {
-                float chance = (double)rand() / RAND_MAX;
-                // continue if chance of spawning lies outside permisible probability
-                if (chance > probability) {
-                    continue;
-                }
-            }
-            actualLimit -= 1;
-            Vector2 generatedPosition = Vector2 {
-                (float)(col * particleDiameter) + particleRadius,
-                (float)(row * particleDiameter) + particleRadius
-            };
-            m_engine.AddParticle(
-                generatedPosition,
-                particleRadius,
-                RED
-            );
-        }
-    }
+    Scenes::SpawnParticles(m_engine, m_screenWidth, m_screenHeight, probability, limit, particleRadius);
 }
 
 void Game::DebugPrint(const char* format, ...) {
@@ -87,17 +70,86 @@ void Game::DebugPrint(const char* format, ...) {
 }
 
 void Game::DrawGameInfo() {
+    // the engine may be in the middle of the next frame, count what is drawn
+    const RenderState& state = m_pipeline.Front();
     DrawText(TextFormat("FPS: %d", GetFPS()), 10, 10, 20, RAYWHITE);
-    DrawText(TextFormat("Particles: %d", m_engine.ParticlesCount()), 10, 35, 15, GRAY);
+    DrawText(
+        TextFormat("Particles: %d  Static: %d", (int)state.ParticlesCount(), (int)state.StaticCollidersCount()),
+        10, 35, 15, GRAY
+    );
+    const size_t asleep = state.asleepCount;
+    DrawText(
+        TextFormat("Awake: %d  Asleep: %d", (int)(state.ParticlesCount() - asleep), (int)asleep),
+        10, 52, 15, GRAY
+    );
+    DrawProfilerInfo(10, 72);
+}
+
+void Game::DrawProfilerInfo(int x, int y) {
+    const prof::Profiler& profiler = prof::Profiler::Instance();
+    if (profiler.FramesCount() == 0) {
+        return;
+    }
+    const int lineHeight = 12;
+    DrawText("phase              min     avg     p99 (ms)", x, y, 10, GRAY);
+    for (uint32_t phase = 0; phase < (uint32_t)prof::Phase::Count; phase++) {
+        prof::PhaseStats stats = profiler.GetPhaseStats((prof::Phase)phase);
+        y += lineHeight;
+        DrawText(
+            TextFormat(
+                "%-16s %6.2f  %6.2f  %6.2f",
+                prof::PhaseName((prof::Phase)phase), stats.minMs, stats.avgMs, stats.p99Ms
+            ),
+            x, y, 10, GRAY
+        );
+    }
+    const double gridParticles = profiler.GetCounterAverage(prof::Counter::GridParticles);
+    if (gridParticles > 0.0) {
+        y += lineHeight;
+        DrawText(
+            TextFormat(
+                "grid migrated: %.2f%% per update",
+                profiler.GetCounterAverage(prof::Counter::GridMigrations) / gridParticles * 100.0
+            ),
+            x, y, 10, GRAY
+        );
+    }
+    if (profiler.WorkersCount() == 0) {
+        return;
+    }
+    // load imbalance shows up as a wide spread between the least and most busy worker
+    double minBusy = 1.0, maxBusy = 0.0, totalBusy = 0.0;
+    for (size_t i = 0; i < profiler.WorkersCount(); i++) {
+        double busy = profiler.GetWorkerStats(i).busy;
+        minBusy = std::min(minBusy, busy);
+        maxBusy = std::max(maxBusy, busy);
+        totalBusy += busy;
+    }
+    y += lineHeight;
+    DrawText(
+        TextFormat(
+            "workers busy: min %.0f%%  avg %.0f%%  max %.0f%%",
+            minBusy * 100.0, totalBusy / profiler.WorkersCount() * 100.0, maxBusy * 100.0
+        ),
+        x, y, 10, GRAY
+    );
 }
 
 void Game::Run() {
+    prof::Profiler& profiler = prof::Profiler::Instance();
+    m_pipeline.Publish();
     while (!WindowShouldClose()) {
-        if (m_processInput) {
+        profiler.BeginFrame();
+        // nothing is being simulated until Update launches the next frame,
+        // input and hotkeys can change the engine
+        ProcessHotkeys();
+        if (m_processInput && !m_replaying) {
             ProcessInput();
         }
         Update();
         Render();
+        m_pipeline.Finish();
+        profiler.EndFrame();
     }
 }
 
@@ -113,36 +165,127 @@ void Game::ProcessInput() {
     if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
         const Vector2& mousePos = GetMousePosition();
         m_engine.AddParticle(mousePos, Constants::PARTICLE_RADIUS, RED);
+        // whatever rests around the cursor has to make room
+        m_engine.WakeAround(mousePos, Constants::PARTICLE_RADIUS * 10.0f);
     }
 }
 
-void Game::Update() {
-    float dt = GetFrameTime();
-    float stepDt = dt / updateSubsteps;
-    bool motionEnabled = FeatureFlags::Instance().IsEnabled(Feature::Motion);
-    bool gravityEnabled = motionEnabled && FeatureFlags::Instance().IsEnabled(Feature::Gravity);
-    if (gravityEnabled) {
-        m_engine.ApplyGravity(Constants::GRAVITY);
+void Game::ProcessHotkeys() {
+    if (IsKeyPressed(KEY_P)) {
+        const char* path = "profile.csv";
+        if (prof::Profiler::Instance().Dump(path)) {
+            DebugPrint("profile written to %s", path);
+        }
+    }
+    if (IsKeyPressed(KEY_T)) {
+        ToggleTrace();
+    }
+    const char* snapshotPath = "snapshot.bin";
+    if (IsKeyPressed(KEY_S)) {
+        if (m_engine.SaveSnapshot(snapshotPath)) {
+            DebugPrint("snapshot written to %s", snapshotPath);
+        }
+    }
+    if (IsKeyPressed(KEY_L)) {
+        if (m_engine.LoadSnapshot(snapshotPath)) {
+            DebugPrint("snapshot loaded from %s", snapshotPath);
+        }
+    }
+    if (IsKeyPressed(KEY_R)) {
+        ToggleRecording();
+    }
+    if (IsKeyPressed(KEY_V)) {
+        ToggleReplay();
     }
-    if (motionEnabled) {
-        m_engine.Update(dt);
+    if (IsKeyPressed(KEY_O)) {
+        // funnel obstacles in and out, particles inside them get pushed out on the next step
+        if (m_engine.GetObstacles().IsEmpty()) {
+            Scenes::AddFunnelObstacles(m_engine, m_screenWidth, m_screenHeight);
+        } else {
+            m_engine.SetObstacles(SignedDistanceField());
+        }
+    }
+}
+
+void Game::ToggleTrace() {
+    prof::TraceRecorder& recorder = prof::TraceRecorder::Instance();
+    if (!recorder.IsRecording()) {
+        recorder.Start();
+        DebugPrint("trace recording started");
+        return;
     }
-    m_engine.ApplyConstraints(m_screenWidth, m_screenHeight);
-    for (int i = 0; i < updateSubsteps; i++) {
-        m_engine.ResolveCollisions();
+    recorder.Stop();
+    const char* path = "trace.json";
+    if (recorder.Write(path)) {
+        DebugPrint("trace written to %s", path);
     }
 }
 
-void Game::Render() {
-    BeginDrawing();
+void Game::ToggleRecording() {
+    const char* path = "recording.vrec";
+    if (!m_recorder.IsRecording()) {
+        if (m_recorder.Start(path, (float)m_screenWidth, (float)m_screenHeight)) {
+            DebugPrint("recording to %s", path);
+        }
+        return;
+    }
+    const bool written = m_recorder.Stop();
+    DebugPrint(
+        "recording %s: %llu frames, %llu dropped", written ? "written" : "failed",
+        (unsigned long long)m_recorder.FramesWritten(), (unsigned long long)m_recorder.FramesDropped()
+    );
+}
 
-    ClearBackground(BLACK);
-    m_engine.Draw(&m_particleTexture);
+void Game::ToggleReplay() {
+    const char* path = "recording.vrec";
+    if (m_replaying) {
+        m_player.Close();
+        m_replaying = false;
+        // back to the live session, which was left where the replay started
+        m_pipeline.Publish();
+        DebugPrint("replay stopped");
+        return;
+    }
+    if (m_recorder.IsRecording()) {
+        ToggleRecording();
+    }
+    m_replaying = m_player.Open(path);
+    if (m_replaying) {
+        DebugPrint("replaying %s", path);
+    }
+}
 
-    // render fps if required
-    if (m_showFPS) {
-        DrawGameInfo();
+void Game::Update() {
+    if (m_replaying) {
+        // the solver stays idle and the engine untouched, frames go straight to the renderer
+        if (m_player.NextFrame()) {
+            m_player.Publish(m_pipeline.Back());
+            m_pipeline.Swap();
+        } else {
+            DebugPrint("replay finished after %llu frames", (unsigned long long)m_player.FramesRead());
+            m_player.Close();
+            m_replaying = false;
+            m_pipeline.Publish();
+        }
+        return;
     }
+    // the state of the frame that was just drawn, before the next one starts changing it
+    m_recorder.Capture(m_engine);
+    m_pipeline.Launch(GetFrameTime());
+}
 
+void Game::Render() {
+    BeginDrawing();
+    {
+        PROFILE_SCOPE(prof::Phase::Render);
+        ClearBackground(BLACK);
+        m_engine.Draw(m_pipeline.Front(), &m_particleTexture, &m_particleRenderer);
+
+        // render fps if required
+        if (m_showFPS) {
+            DrawGameInfo();
+        }
+    }
+    // kept out of the render phase, it also waits for the target frame rate
     EndDrawing();
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <climits>
 #include <raylib.h>
 #include "Constants.hpp"
+#include "Engine/FramePipeline.hpp"
+#include "Engine/FramePlayer.hpp"
+#include "Engine/FrameRecorder.hpp"
+#include "Engine/ParticleRenderer.hpp"
+#include "Engine/Simulation.hpp"
 #include "Engine/VerletEngine.hpp"
 #include "utils/ThreadPool.hpp"
 
@@ -16,18 +22,29 @@ public:
     void ShouldProcessInput(bool shouldProcess);
 
 private:
-    static constexpr uint32_t updateSubsteps = 4u;
-
     mt::ThreadPool& m_threadPool;
     const uint32_t m_screenWidth, m_screenHeight;
     bool m_running, m_showFPS, m_processInput;
     VerletEngine m_engine;
+    Simulation m_simulation;
+    // the simulation of the next frame runs while the current one is drawn
+    FramePipeline m_pipeline;
     Texture2D m_particleTexture;
-    
+    ParticleRenderer m_particleRenderer;
+    FrameRecorder m_recorder;
+    FramePlayer m_player;
+    // frames come from m_player instead of the simulation
+    bool m_replaying = false;
+
     void LoadResources();
     void UnloadResources();
     void DebugPrint(const char* str, ...);
     void DrawGameInfo();
+    void DrawProfilerInfo(int x, int y);
+    void ProcessHotkeys();
+    void ToggleTrace();
+    void ToggleRecording();
+    void ToggleReplay();
     void ProcessInput();
     void Update();
     void Render();
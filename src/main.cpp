@@ -11,6 +11,14 @@ int main(int args, char** argv) {
     flags.Enable(Feature::Gravity);
     flags.Enable(Feature::Logging);
     flags.Enable(Feature::SpatialHash);
+    flags.Enable(Feature::DenseGrid);
+    flags.Enable(Feature::LockFreeSolve);
+    flags.Enable(Feature::StreamingCollisions);
+    flags.Enable(Feature::IncrementalGrid);
+    flags.Enable(Feature::MultiLevelGrid);
+    flags.Enable(Feature::Sleeping);
+    flags.Enable(Feature::BatchedRendering);
+    flags.Enable(Feature::PipelinedFrames);
 
     int32_t width = Constants::SCREEN_WIDTH;
     int32_t height = Constants::SCREEN_HEIGHT;
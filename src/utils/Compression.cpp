@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "Compression.hpp"
+
+namespace lz {
+
+static constexpr size_t minMatch = 4;
+static constexpr size_t maxOffset = 65535;
+static constexpr uint32_t hashBits = 16;
+// the last bytes are always literals, so matches never have to check the end of the input
+static constexpr size_t lastLiterals = 5;
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+// lengths past the nibble are written as 255s and a remainder
+static inline uint8_t* writeLength(uint8_t* out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+static inline uint8_t* writeSequence(uint8_t* out, const uint8_t* literals, size_t literalsCount, size_t offset, size_t matchLength) {
+    uint8_t* token = out++;
+    *token = (uint8_t)(std::min<size_t>(literalsCount, 15) << 4);
+    if (literalsCount >= 15) {
+        out = writeLength(out, literalsCount - 15);
+    }
+    if (literalsCount > 0) {
+        // literals is null for empty input, memcpy doesn't allow that even for 0 bytes
+        memcpy(out, literals, literalsCount);
+        out += literalsCount;
+    }
+    if (matchLength == 0) {
+        return out;
+    }
+    *out++ = (uint8_t)(offset & 0xFF);
+    *out++ = (uint8_t)(offset >> 8);
+    const size_t extra = matchLength - minMatch;
+    *token |= (uint8_t)std::min<size_t>(extra, 15);
+    if (extra >= 15) {
+        out = writeLength(out, extra - 15);
+    }
+    return out;
+}
+
+size_t Compress(const uint8_t* src, size_t size, uint8_t* dst) {
+    uint8_t* out = dst;
+    size_t anchor = 0;
+    if (size > minMatch + lastLiterals) {
+        // positions + 1, 0 is an empty slot. thread_local so concurrent compressors don't share it
+        thread_local std::vector<uint32_t> table;
+        table.assign((size_t)1 << hashBits, 0);
+        const size_t matchLimit = size - lastLiterals;
+        size_t position = 0;
+        uint32_t misses = 0;
+        while (position + minMatch <= matchLimit) {
+            const uint32_t sequence = read32(src + position);
+            uint32_t& slot = table[hash(sequence)];
+            const size_t candidate = (size_t)slot - 1;
+            slot = (uint32_t)position + 1;
+            if (candidate >= position || position - candidate > maxOffset || read32(src + candidate) != sequence) {
+                // skip faster through data that doesn't compress
+                position += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            size_t length = minMatch;
+            while (position + length < matchLimit && src[candidate + length] == src[position + length]) {
+                length++;
+            }
+            out = writeSequence(out, src + anchor, position - anchor, position - candidate, length);
+            position += length;
+            anchor = position;
+        }
+    }
+    out = writeSequence(out, src + anchor, size - anchor, 0, 0);
+    return (size_t)(out - dst);
+}
+
+// reads a length continued past the nibble, false if it runs past the input
+static inline bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+    uint8_t value;
+    do {
+        if (in >= end) {
+            return false;
+        }
+        value = *in++;
+        length += value;
+    } while (value == 255);
+    return true;
+}
+
+bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* in = src;
+    const uint8_t* inEnd = src + srcSize;
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + dstSize;
+    while (in < inEnd) {
+        const uint8_t token = *in++;
+        size_t literalsCount = token >> 4;
+        if (literalsCount == 15 && !readLength(in, inEnd, literalsCount)) {
+            return false;
+        }
+        if (literalsCount > (size_t)(inEnd - in) || literalsCount > (size_t)(outEnd - out)) {
+            return false;
+        }
+        if (literalsCount > 0) {
+            memcpy(out, in, literalsCount);
+            in += literalsCount;
+            out += literalsCount;
+        }
+        if (in == inEnd) {
+            // the last sequence has no match
+            break;
+        }
+        if (inEnd - in < 2) {
+            return false;
+        }
+        const size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(in, inEnd, length)) {
+            return false;
+        }
+        length += minMatch;
+        if (offset == 0 || offset > (size_t)(out - dst) || length > (size_t)(outEnd - out)) {
+            return false;
+        }
+        // byte by byte, a match may overlap the bytes it is producing (runs have offset 1)
+        const uint8_t* match = out - offset;
+        for (size_t i = 0; i < length; i++) {
+            out[i] = match[i];
+        }
+        out += length;
+    }
+    return out == outEnd;
+}
+
+} // namespace lz
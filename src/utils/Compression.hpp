@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// Small LZ77 block compressor in the spirit of LZ4: greedy matches found through a
+/// hash of the next 4 bytes, no entropy coding. It trades ratio for speed, which
+/// suits data with long runs and repeats (e.g. byte planes of mostly zero deltas).
+///
+/// A block is a list of sequences: a token (literal count in the high nibble, match
+/// length - 4 in the low one, 15 means more length bytes follow), the literals, then a
+/// 2 byte little-endian match offset. The last sequence only has literals.
+
+namespace lz {
+
+// worst case compressed size of `size` input bytes
+inline size_t CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// compresses `size` bytes of `src` into `dst`, which must hold CompressBound(size) bytes.
+// returns the compressed size
+size_t Compress(const uint8_t* src, size_t size, uint8_t* dst);
+
+// decompresses a block that expands to exactly `dstSize` bytes,
+// returns false if the block is corrupt instead of reading or writing out of bounds
+bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
+} // namespace lz
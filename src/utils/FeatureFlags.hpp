@@ -2,11 +2,21 @@
 #include <cstdint>
 
 enum class Feature : uint32_t {
-    None         = 0,
-    Logging      = 1 << 0,
-    Motion       = 1 << 1,
-    Gravity      = 1 << 2,
-    SpatialHash  = 1 << 3};
+    None                = 0,
+    Logging             = 1 << 0,
+    Motion              = 1 << 1,
+    Gravity             = 1 << 2,
+    SpatialHash         = 1 << 3,
+    DenseGrid           = 1 << 4,
+    LockFreeSolve       = 1 << 5,
+    StreamingCollisions = 1 << 6,
+    IncrementalGrid     = 1 << 7,
+    NeighborList        = 1 << 8,
+    MultiLevelGrid      = 1 << 9,
+    Sleeping            = 1 << 10,
+    Deterministic       = 1 << 11,
+    BatchedRendering    = 1 << 12,
+    PipelinedFrames     = 1 << 13};
 
 class FeatureFlags {
 public:
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstdio>
+#include "Profiler.hpp"
+#include "ThreadPool.hpp"
+
+namespace prof {
+
+const char* PhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::Frame:          return "frame";
+        case Phase::Simulation:     return "simulation";
+        case Phase::Forces:         return "forces";
+        case Phase::Integrate:      return "integrate";
+        case Phase::Constraints:    return "constraints";
+        case Phase::Step:           return "step";
+        case Phase::Reorder:        return "reorder";
+        case Phase::GridBuild:      return "grid build";
+        case Phase::PairGeneration: return "pair generation";
+        case Phase::PairResolution: return "pair resolution";
+        case Phase::Render:         return "render";
+        case Phase::EngineDraw:     return "engine draw";
+        default:                    return "unknown";
+    }
+}
+
+const char* CounterName(Counter counter) {
+    switch (counter) {
+        case Counter::GridParticles:      return "grid particles";
+        case Counter::GridMigrations:     return "grid migrations";
+        case Counter::NeighborListBuilds: return "neighbor list builds";
+        case Counter::PairTests:          return "pair tests";
+        default:                          return "unknown";
+    }
+}
+
+void Profiler::AttachThreadPool(const mt::ThreadPool* threadPool) {
+    m_threadPool = threadPool;
+    const size_t workersCount = threadPool != nullptr ? threadPool->threadCount : 0;
+    m_workerBusyAtFrameStart.assign(workersCount, 0);
+    m_workerHistory.assign(workersCount, std::vector<float>(historySize, 0.0f));
+}
+
+void Profiler::BeginFrame() {
+    if (!enabled) {
+        return;
+    }
+    m_frameStart = Clock::now();
+    for (size_t i = 0; i < m_workerBusyAtFrameStart.size(); i++) {
+        m_workerBusyAtFrameStart[i] = m_threadPool->WorkerBusyNs(i);
+    }
+}
+
+void Profiler::EndFrame() {
+    if (!enabled) {
+        return;
+    }
+    const uint64_t frameNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - m_frameStart
+    ).count();
+    m_current[(size_t)Phase::Frame] = frameNs;
+
+    for (size_t phase = 0; phase < (size_t)Phase::Count; phase++) {
+        m_history[phase][m_cursor] = m_current[phase];
+        m_current[phase] = 0;
+    }
+    for (size_t counter = 0; counter < (size_t)Counter::Count; counter++) {
+        m_counterHistory[counter][m_cursor] = m_currentCounters[counter];
+        m_currentCounters[counter] = 0;
+    }
+    for (size_t i = 0; i < m_workerHistory.size(); i++) {
+        uint64_t busyNs = m_threadPool->WorkerBusyNs(i) - m_workerBusyAtFrameStart[i];
+        m_workerHistory[i][m_cursor] = frameNs > 0 ? std::min(1.0f, (float)busyNs / frameNs) : 0.0f;
+    }
+    m_cursor = (m_cursor + 1) % historySize;
+    m_framesCount = std::min(m_framesCount + 1, historySize);
+}
+
+PhaseStats Profiler::GetPhaseStats(Phase phase) const {
+    PhaseStats stats;
+    if (m_framesCount == 0) {
+        return stats;
+    }
+    // the window is small, sorting a copy for the percentile is cheap enough
+    uint64_t samples[historySize];
+    std::copy(m_history[(size_t)phase], m_history[(size_t)phase] + m_framesCount, samples);
+    std::sort(samples, samples + m_framesCount);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < m_framesCount; i++) {
+        total += samples[i];
+    }
+    const size_t p99Index = std::min(m_framesCount - 1, (m_framesCount * 99 + 99) / 100 - 1);
+    stats.minMs = samples[0] / 1e6;
+    stats.avgMs = (double)total / m_framesCount / 1e6;
+    stats.p99Ms = samples[p99Index] / 1e6;
+    return stats;
+}
+
+double Profiler::GetLastFrameMs(Phase phase) const {
+    if (m_framesCount == 0) {
+        return 0.0;
+    }
+    return m_history[(size_t)phase][(m_cursor + historySize - 1) % historySize] / 1e6;
+}
+
+uint64_t Profiler::GetLastFrameCount(Counter counter) const {
+    if (m_framesCount == 0) {
+        return 0;
+    }
+    return m_counterHistory[(size_t)counter][(m_cursor + historySize - 1) % historySize];
+}
+
+double Profiler::GetCounterAverage(Counter counter) const {
+    if (m_framesCount == 0) {
+        return 0.0;
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < m_framesCount; i++) {
+        total += m_counterHistory[(size_t)counter][i];
+    }
+    return (double)total / m_framesCount;
+}
+
+WorkerStats Profiler::GetWorkerStats(size_t worker) const {
+    WorkerStats stats;
+    if (m_framesCount == 0) {
+        return stats;
+    }
+    double total = 0.0;
+    for (size_t i = 0; i < m_framesCount; i++) {
+        total += m_workerHistory[worker][i];
+    }
+    stats.busy = total / m_framesCount;
+    return stats;
+}
+
+bool Profiler::Dump(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fprintf(file, "phase,min_ms,avg_ms,p99_ms\n");
+    for (size_t phase = 0; phase < (size_t)Phase::Count; phase++) {
+        PhaseStats stats = GetPhaseStats((Phase)phase);
+        fprintf(file, "%s,%.4f,%.4f,%.4f\n", PhaseName((Phase)phase), stats.minMs, stats.avgMs, stats.p99Ms);
+    }
+    fprintf(file, "\ncounter,avg_per_frame\n");
+    for (size_t counter = 0; counter < (size_t)Counter::Count; counter++) {
+        fprintf(file, "%s,%.1f\n", CounterName((Counter)counter), GetCounterAverage((Counter)counter));
+    }
+    fprintf(file, "\nworker,busy_pct,idle_pct\n");
+    for (size_t i = 0; i < WorkersCount(); i++) {
+        WorkerStats stats = GetWorkerStats(i);
+        fprintf(file, "%zu,%.1f,%.1f\n", i, stats.busy * 100.0, (1.0 - stats.busy) * 100.0);
+    }
+    fclose(file);
+    return true;
+}
+
+} // namespace prof
@@ -0,0 +1,172 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TraceRecorder.hpp"
+
+namespace mt {
+class ThreadPool;
+}
+
+/// Lightweight per-phase frame profiler.
+/// Phases are timed with PROFILE_SCOPE, which compiles to nothing unless
+/// ENABLE_PROFILER is defined (./build.sh turns it on, PROFILER=0 turns it off).
+/// Samples of one frame are summed per phase (and per counter) and kept in a rolling window,
+/// along with every thread pool worker's busy time for load imbalance.
+/// Phase timers are meant for the threads driving the frame (main and, with a
+/// FramePipeline, simulation), not for workers. A phase is only timed on one of them.
+/// While the TraceRecorder is recording, every timed scope also becomes a trace event.
+
+namespace prof {
+
+enum class Phase : uint32_t {
+    Frame,
+    Simulation,
+    Forces,
+    Integrate,
+    Constraints,
+    Step,
+    Reorder,
+    GridBuild,
+    PairGeneration,
+    PairResolution,
+    Render,
+    EngineDraw,
+    Count
+};
+
+const char* PhaseName(Phase phase);
+
+// per frame totals of things that are counted rather than timed
+enum class Counter : uint32_t {
+    // particles checked by incremental grid updates
+    GridParticles,
+    // particles that changed cell in incremental grid updates
+    GridMigrations,
+    // neighbor list rebuilds, the rest of the substeps reuse the lists
+    NeighborListBuilds,
+    // candidate pairs handed from the broadphase to the collision check
+    PairTests,
+    Count
+};
+
+const char* CounterName(Counter counter);
+
+struct PhaseStats {
+    double minMs = 0.0;
+    double avgMs = 0.0;
+    double p99Ms = 0.0;
+};
+
+struct WorkerStats {
+    // fraction of the frame the worker spent running tasks, averaged over the window
+    double busy = 0.0;
+};
+
+class Profiler {
+public:
+    static constexpr size_t historySize = 240;
+#ifdef ENABLE_PROFILER
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    // Singleton accessor
+    static Profiler& Instance() {
+        static Profiler instance;
+        return instance;
+    }
+
+    void AttachThreadPool(const mt::ThreadPool* threadPool);
+
+    void BeginFrame();
+    void EndFrame();
+
+    inline void AddSample(Phase phase, uint64_t nanoseconds) {
+        m_current[(size_t)phase] += nanoseconds;
+    }
+
+    // recorded frames in the window, at most historySize
+    inline size_t FramesCount() const {
+        return m_framesCount;
+    }
+
+    PhaseStats GetPhaseStats(Phase phase) const;
+
+    // totals of the most recent frame, for callers that keep their own longer statistics
+    double GetLastFrameMs(Phase phase) const;
+    uint64_t GetLastFrameCount(Counter counter) const;
+
+    // like AddSample, only for the thread driving the frame
+    inline void AddCount(Counter counter, uint64_t value) {
+        m_currentCounters[(size_t)counter] += value;
+    }
+
+    // average per frame total over the window
+    double GetCounterAverage(Counter counter) const;
+
+    inline size_t WorkersCount() const {
+        return m_workerHistory.size();
+    }
+
+    WorkerStats GetWorkerStats(size_t worker) const;
+
+    // writes per phase and per worker stats as CSV, returns false if the file can't be opened
+    bool Dump(const char* path) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Profiler() = default;
+    ~Profiler() = default;
+
+    // Prevent copying/moving
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    const mt::ThreadPool* m_threadPool = nullptr;
+    Clock::time_point m_frameStart;
+
+    uint64_t m_current[(size_t)Phase::Count] = {};
+    // ring buffers of per frame totals, in nanoseconds
+    uint64_t m_history[(size_t)Phase::Count][historySize] = {};
+    uint64_t m_currentCounters[(size_t)Counter::Count] = {};
+    uint64_t m_counterHistory[(size_t)Counter::Count][historySize] = {};
+    size_t m_cursor = 0;
+    size_t m_framesCount = 0;
+
+    std::vector<uint64_t> m_workerBusyAtFrameStart;
+    std::vector<std::vector<float>> m_workerHistory;
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase)
+        : m_phase(phase)
+        , m_startNs(TraceRecorder::Instance().Now())
+        {}
+
+    ~ScopedTimer() {
+        TraceRecorder& recorder = TraceRecorder::Instance();
+        const uint64_t endNs = recorder.Now();
+        Profiler::Instance().AddSample(m_phase, endNs - m_startNs);
+        recorder.Record(PhaseName(m_phase), m_startNs, endNs);
+    }
+
+private:
+    Phase m_phase;
+    uint64_t m_startNs;
+};
+
+} // namespace prof
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_SCOPE(phase) prof::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase)
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mt {
+
+/// Double ended queue on a power of two ring, preallocated up front.
+/// It doubles when it runs full and never shrinks, so once it has grown to its
+/// working size pushing and popping don't allocate. Not thread safe.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity = 64) {
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        m_items.resize(rounded);
+    }
+
+    inline bool Empty() const {
+        return m_size == 0;
+    }
+
+    inline size_t Size() const {
+        return m_size;
+    }
+
+    inline size_t Capacity() const {
+        return m_items.size();
+    }
+
+    inline void PushBack(T item) {
+        if (m_size == m_items.size()) {
+            grow();
+        }
+        m_items[(m_head + m_size) & (m_items.size() - 1)] = std::move(item);
+        m_size++;
+    }
+
+    inline T& Front() {
+        return m_items[m_head];
+    }
+
+    inline T& Back() {
+        return m_items[(m_head + m_size - 1) & (m_items.size() - 1)];
+    }
+
+    inline void PopFront() {
+        m_head = (m_head + 1) & (m_items.size() - 1);
+        m_size--;
+    }
+
+    inline void PopBack() {
+        m_size--;
+    }
+
+private:
+    void grow() {
+        // unwraps the items to the front of the bigger ring
+        std::vector<T> items(m_items.size() * 2);
+        for (size_t i = 0; i < m_size; i++) {
+            items[i] = std::move(m_items[(m_head + i) & (m_items.size() - 1)]);
+        }
+        m_items.swap(items);
+        m_head = 0;
+    }
+
+    std::vector<T> m_items;
+    size_t m_head = 0;
+    size_t m_size = 0;
+};
+
+} // namespace mt
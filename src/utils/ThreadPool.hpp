@@ -1,47 +1,148 @@
 #pragma once
 #include <thread>
 #include <vector>
-#include <queue>
-#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <cstddef>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include "RingBuffer.hpp"
+#include "TraceRecorder.hpp"
 
 namespace mt {
 
+// How dispatch() spreads a range of work over the workers
+enum class Scheduling {
+    // one shared task queue, the range is cut in exactly threadCount static chunks
+    SharedQueue,
+    // every worker owns a deque of ranges, ranges are split down to the grain size
+    // and idle workers steal from the others
+    WorkStealing
+};
+
+// A callable stored inline, so queueing one never allocates. The captures have to
+// fit in `capacity` bytes and be trivially copyable (references, pointers, indices)
+class Task {
+public:
+    static constexpr size_t capacity = 48;
+
+    Task() = default;
+
+    template <typename Function, typename = std::enable_if_t<!std::is_same<std::decay_t<Function>, Task>::value>>
+    Task(Function function) {
+        static_assert(sizeof(Function) <= capacity, "task captures too much, capture a reference to it instead");
+        static_assert(alignof(Function) <= alignof(std::max_align_t), "task captures are over aligned");
+        static_assert(
+            std::is_trivially_copyable<Function>::value && std::is_trivially_destructible<Function>::value,
+            "tasks are copied around as plain bytes and never destroyed"
+        );
+        new (m_storage) Function(function);
+        m_invoke = [](void* storage) {
+            (*static_cast<Function*>(storage))();
+        };
+    }
+
+    inline explicit operator bool() const {
+        return m_invoke != nullptr;
+    }
+
+    inline void operator()() {
+        m_invoke(m_storage);
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char m_storage[capacity];
+    void (*m_invoke)(void*) = nullptr;
+};
+
 class ThreadPool {
 public:
     const uint32_t threadCount;
+    const Scheduling scheduling;
 
-    explicit ThreadPool(size_t threadCount);
+    explicit ThreadPool(size_t threadCount, Scheduling scheduling = Scheduling::WorkStealing);
     ~ThreadPool();
 
-    // Submit a single task
-    void addTask(std::function<void()> task);
+    // Submit a single task, see Task for what it may capture
+    template <typename Function>
+    void addTask(Function task);
 
     // Dispatch a range of work
+    // grainSize is the smallest range handed to the callback when work stealing,
+    // 0 picks one based on count and thread count
     template <typename Callback>
-    void dispatch(size_t count, Callback callback);
+    void dispatch(size_t count, Callback callback, size_t grainSize = 0);
 
     void wait();
 
+    // total time the worker spent running tasks, only counted when ENABLE_PROFILER is defined
+    inline uint64_t WorkerBusyNs(size_t workerIndex) const {
+        return m_queues[workerIndex]->busyNs.load(std::memory_order_relaxed);
+    }
+
 private:
-    void workerLoop();
+    struct Range {
+        size_t begin, end;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        RingBuffer<Range> ranges;
+        std::atomic<uint64_t> busyNs = { 0 };
+    };
+
+    // adds the time since `startNs` to the worker's busy counter and the trace
+    inline void addBusyTime(size_t workerIndex, uint64_t startNs) {
+        prof::TraceRecorder& recorder = prof::TraceRecorder::Instance();
+        const uint64_t endNs = recorder.Now();
+        m_queues[workerIndex]->busyNs.fetch_add(endNs - startNs, std::memory_order_relaxed);
+        recorder.Record("task", startNs, endNs);
+    }
+
+    void workerLoop(size_t workerIndex);
+    void runJob(size_t workerIndex);
+    bool popRange(size_t workerIndex, Range& range);
+    bool stealRange(size_t workerIndex, Range& range);
+
+    template <typename Callback>
+    void dispatchSharedQueue(size_t count, Callback& callback);
+    template <typename Callback>
+    void dispatchWorkStealing(size_t count, Callback& callback, size_t grainSize);
 
     std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_tasks;
+    // preallocated, dispatching doesn't allocate once the pool has warmed up
+    RingBuffer<Task> m_tasks;
 
     std::mutex m_mutex;
     std::condition_variable m_cv;
 
     std::atomic<bool> m_stop = { false };
     std::atomic<size_t> m_pending = { 0 };
+
+    // current work stealing job, only written under m_mutex while no worker is active
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    void (*m_jobInvoke)(void*, size_t, size_t) = nullptr;
+    void* m_jobContext = nullptr;
+    size_t m_jobGrain = 1;
+    uint64_t m_jobEpoch = 0;
+    std::atomic<size_t> m_jobRemaining = { 0 };
+    size_t m_jobActive = 0;
+    std::condition_variable m_jobDoneCv;
 };
 
 // Constructor: start worker threads
-inline ThreadPool::ThreadPool(size_t threadCount): threadCount(threadCount) {
+inline ThreadPool::ThreadPool(size_t threadCount, Scheduling scheduling)
+    : threadCount(threadCount)
+    , scheduling(scheduling) {
+    for (size_t i = 0; i < threadCount; i++) {
+        m_queues.emplace_back(std::make_unique<WorkerQueue>());
+    }
     for (size_t i = 0; i < threadCount; i++) {
-        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
     }
 }
 
@@ -58,18 +159,29 @@ inline ThreadPool::~ThreadPool() {
 }
 
 // Adds a task to the queue
-inline void ThreadPool::addTask(std::function<void()> task) {
+template <typename Function>
+inline void ThreadPool::addTask(Function task) {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_tasks.push(move(task));
+        m_tasks.PushBack(Task(task));
         m_pending++;
     }
     m_cv.notify_one();
 }
 
+// Dispatches work across threads, blocks until every index is processed
+template <typename Callback>
+inline void ThreadPool::dispatch(size_t count, Callback callback, size_t grainSize) {
+    if (scheduling == Scheduling::WorkStealing) {
+        dispatchWorkStealing(count, callback, grainSize);
+    } else {
+        dispatchSharedQueue(count, callback);
+    }
+}
+
 // Dispatches work across threads in batches
 template <typename Callback>
-inline void ThreadPool::dispatch(size_t count, Callback callback) {
+inline void ThreadPool::dispatchSharedQueue(size_t count, Callback& callback) {
     wait();
     const size_t threadCount = m_workers.size();
     const size_t batch = count / threadCount;
@@ -83,7 +195,8 @@ inline void ThreadPool::dispatch(size_t count, Callback callback) {
             break;
         }
 
-        addTask([=]() {
+        // callback outlives the task because dispatch blocks until it is done
+        addTask([&callback, start, end]() {
             callback(start, end);
         });
 
@@ -93,6 +206,52 @@ inline void ThreadPool::dispatch(size_t count, Callback callback) {
     wait();
 }
 
+// Seeds every worker deque with an equal share and lets the workers split and steal
+template <typename Callback>
+inline void ThreadPool::dispatchWorkStealing(size_t count, Callback& callback, size_t grainSize) {
+    wait();
+    if (count == 0) {
+        return;
+    }
+    const size_t threadCount = m_workers.size();
+    if (grainSize == 0) {
+        // a few ranges per thread are enough for stealing to balance the load
+        grainSize = std::max<size_t>(1, count / (threadCount * 8));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // previous job may still have workers on their way out
+        m_jobDoneCv.wait(lock, [&] { return m_jobActive == 0; });
+
+        // callback outlives the job because dispatch blocks until it is done
+        m_jobContext = &callback;
+        m_jobInvoke = [](void* context, size_t start, size_t end) {
+            (*static_cast<Callback*>(context))(start, end);
+        };
+        m_jobGrain = grainSize;
+        m_jobRemaining = count;
+
+        const size_t batch = count / threadCount;
+        const size_t extra = count % threadCount;
+        size_t start = 0;
+        for (size_t i = 0; i < threadCount && start < count; i++) {
+            size_t end = start + batch + (i < extra ? 1 : 0);
+            if (start >= end) {
+                continue;
+            }
+            std::lock_guard<std::mutex> queueLock(m_queues[i]->mutex);
+            m_queues[i]->ranges.PushBack(Range { start, end });
+            start = end;
+        }
+        m_jobEpoch++;
+    }
+    m_cv.notify_all();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDoneCv.wait(lock, [&] { return m_jobRemaining == 0 && m_jobActive == 0; });
+}
+
 // Waits for all tasks to complete
 inline void ThreadPool::wait() {
     // while (m_pending > 0) {
@@ -103,23 +262,50 @@ inline void ThreadPool::wait() {
 }
 
 // Worker thread function
-inline void ThreadPool::workerLoop() {
+inline void ThreadPool::workerLoop(size_t workerIndex) {
+#ifdef ENABLE_PROFILER
+    char threadName[32];
+    snprintf(threadName, sizeof(threadName), "worker %zu", workerIndex);
+    prof::TraceRecorder::Instance().SetThreadName(threadName);
+#endif
+    uint64_t seenEpoch = 0;
     while (true) {
-        std::function<void()> task;
+        Task task;
 
         {
             std::unique_lock<std::mutex> lock(m_mutex);
             m_cv.wait(lock, [&]() {
-                return m_stop || !m_tasks.empty();
+                return m_stop || !m_tasks.Empty() || m_jobEpoch != seenEpoch;
             });
 
-            if (m_stop && m_tasks.empty()) return;
+            if (m_jobEpoch != seenEpoch) {
+                seenEpoch = m_jobEpoch;
+                m_jobActive++;
+            } else {
+                if (m_stop && m_tasks.Empty()) return;
 
-            task = move(m_tasks.front());
-            m_tasks.pop();
+                task = m_tasks.Front();
+                m_tasks.PopFront();
+            }
+        }
+
+        if (!task) {
+            runJob(workerIndex);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobActive--;
+            if (m_jobActive == 0) {
+                m_jobDoneCv.notify_all();
+            }
+            continue;
         }
 
+#ifdef ENABLE_PROFILER
+        uint64_t taskStart = prof::TraceRecorder::Instance().Now();
+        task();
+        addBusyTime(workerIndex, taskStart);
+#else
         task();
+#endif
         {
             std::lock_guard<std::mutex> lock(m_mutex);
             m_pending--;
@@ -130,4 +316,63 @@ inline void ThreadPool::workerLoop() {
     }
 }
 
+// Processes ranges of the current job until all of it is done
+inline void ThreadPool::runJob(size_t workerIndex) {
+    Range range;
+    while (m_jobRemaining > 0) {
+        if (!popRange(workerIndex, range) && !stealRange(workerIndex, range)) {
+            // everything left is being processed or split by other workers
+            std::this_thread::yield();
+            continue;
+        }
+
+        // keep splitting in half, the upper halves go to our deque for thieves to take
+        while (range.end - range.begin > m_jobGrain) {
+            size_t middle = range.begin + (range.end - range.begin) / 2;
+            {
+                std::lock_guard<std::mutex> lock(m_queues[workerIndex]->mutex);
+                m_queues[workerIndex]->ranges.PushBack(Range { middle, range.end });
+            }
+            range.end = middle;
+        }
+
+#ifdef ENABLE_PROFILER
+        uint64_t rangeStart = prof::TraceRecorder::Instance().Now();
+        m_jobInvoke(m_jobContext, range.begin, range.end);
+        addBusyTime(workerIndex, rangeStart);
+#else
+        m_jobInvoke(m_jobContext, range.begin, range.end);
+#endif
+        m_jobRemaining -= range.end - range.begin;
+    }
+}
+
+// Owner takes the most recently pushed (smallest, cache warm) range
+inline bool ThreadPool::popRange(size_t workerIndex, Range& range) {
+    WorkerQueue& queue = *m_queues[workerIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.ranges.Empty()) {
+        return false;
+    }
+    range = queue.ranges.Back();
+    queue.ranges.PopBack();
+    return true;
+}
+
+// Thieves take the oldest (largest) range from the other end
+inline bool ThreadPool::stealRange(size_t workerIndex, Range& range) {
+    const size_t queuesCount = m_queues.size();
+    for (size_t offset = 1; offset < queuesCount; offset++) {
+        WorkerQueue& victim = *m_queues[(workerIndex + offset) % queuesCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.ranges.Empty()) {
+            continue;
+        }
+        range = victim.ranges.Front();
+        victim.ranges.PopFront();
+        return true;
+    }
+    return false;
+}
+
 } // namespace mt
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstdio>
+#include "TraceRecorder.hpp"
+
+namespace prof {
+
+// rounds up so the ring buffer index can be masked instead of using modulo
+static size_t nextPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void TraceRecorder::Start(size_t eventsPerThread) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (IsRecording()) {
+        return;
+    }
+    m_eventsPerThread = nextPowerOfTwo(std::max<size_t>(1, eventsPerThread));
+    // allocate everything up front, recording itself never allocates
+    for (auto& buffer : m_buffers) {
+        buffer->events.resize(m_eventsPerThread);
+        buffer->mask = m_eventsPerThread - 1;
+        buffer->written.store(0, std::memory_order_relaxed);
+    }
+    m_recording.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::Stop() {
+    m_recording.store(false, std::memory_order_release);
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+    ThreadBuffer* buffer = threadBuffer();
+    snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::registerThread() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    ThreadBuffer* buffer = m_buffers.back().get();
+    buffer->threadId = (uint32_t)m_buffers.size();
+    if (IsRecording()) {
+        buffer->events.resize(m_eventsPerThread);
+        buffer->mask = m_eventsPerThread - 1;
+    }
+    return buffer;
+}
+
+bool TraceRecorder::Write(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& buffer : m_buffers) {
+        if (buffer->name[0] != '\0') {
+            fprintf(
+                file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", buffer->threadId, buffer->name
+            );
+            first = false;
+        }
+        if (buffer->events.empty()) {
+            continue;
+        }
+        // only the last events.size() events survive a wrapped ring buffer
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t capacity = buffer->events.size();
+        const uint64_t begin = written > capacity ? written - capacity : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            const Event& event = buffer->events[i & buffer->mask];
+            fprintf(
+                file,
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", event.name, buffer->threadId,
+                event.beginNs / 1000.0, (event.endNs - event.beginNs) / 1000.0
+            );
+            first = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+} // namespace prof
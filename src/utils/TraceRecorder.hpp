@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Records timed events per thread and writes them as a Chrome trace JSON,
+/// to open in chrome://tracing or Perfetto.
+/// Every thread writes into its own preallocated ring buffer, so recording an
+/// event is two clock reads and a store, without locks or allocations.
+/// When a buffer wraps, the oldest events of that thread are overwritten.
+/// Events come from PROFILE_SCOPE phases and thread pool tasks, so like the
+/// profiler it only records anything when built with ENABLE_PROFILER.
+
+namespace prof {
+
+class TraceRecorder {
+public:
+    static constexpr size_t defaultEventsPerThread = 1 << 17;
+
+    // Singleton accessor
+    static TraceRecorder& Instance() {
+        static TraceRecorder instance;
+        return instance;
+    }
+
+    void Start(size_t eventsPerThread = defaultEventsPerThread);
+    void Stop();
+
+    inline bool IsRecording() const {
+        return m_recording.load(std::memory_order_acquire);
+    }
+
+    // name shown for the calling thread in the trace.
+    // cheap to call up front, event storage is only allocated once recording starts
+    void SetThreadName(const char* name);
+
+    inline uint64_t Now() const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_epoch
+        ).count();
+    }
+
+    // `name` must be a string literal (or live as long as the recorder)
+    inline void Record(const char* name, uint64_t beginNs, uint64_t endNs) {
+        if (!IsRecording()) {
+            return;
+        }
+        ThreadBuffer* buffer = threadBuffer();
+        const uint64_t index = buffer->written.load(std::memory_order_relaxed);
+        buffer->events[index & buffer->mask] = Event { name, beginNs, endNs };
+        buffer->written.store(index + 1, std::memory_order_release);
+    }
+
+    // writes everything recorded so far, returns false if the file can't be opened
+    bool Write(const char* path) const;
+
+private:
+    struct Event {
+        const char* name;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+
+    struct ThreadBuffer {
+        uint32_t threadId = 0;
+        char name[32] = {};
+        std::vector<Event> events;
+        uint64_t mask = 0;
+        std::atomic<uint64_t> written = { 0 };
+    };
+
+    TraceRecorder()
+        : m_epoch(std::chrono::steady_clock::now())
+        {}
+    ~TraceRecorder() = default;
+
+    // Prevent copying/moving
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    inline ThreadBuffer* threadBuffer() {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            buffer = registerThread();
+        }
+        return buffer;
+    }
+
+    ThreadBuffer* registerThread();
+
+    const std::chrono::steady_clock::time_point m_epoch;
+    std::atomic<bool> m_recording = { false };
+    size_t m_eventsPerThread = defaultEventsPerThread;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+} // namespace prof